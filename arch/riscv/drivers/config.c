@@ -13,6 +13,7 @@
 #include <linux/sysfs.h>
 #include <linux/slab.h>
 #include <linux/platform_device.h>
+#include <asm/sbi.h>
 
 static ssize_t config_read(struct file *filp, struct kobject *kobj,
                            struct bin_attribute *attr,
@@ -296,6 +297,44 @@ empty_out:
 }
 EXPORT_SYMBOL_GPL(config_string_str)
 
+int config_string_has(struct platform_device *pdev, const char *key)
+{
+	const char *start = pdev->archdata.config_start;
+	const char *end = pdev->archdata.config_end;
+	const char *value;
+
+	if (!start || !end) return 0;
+
+	/* A miss inside a nested block stops at its closing brace */
+	value = find_key(start, end, key, 1);
+	return end - value > 0 && *value != '}';
+}
+EXPORT_SYMBOL_GPL(config_string_has)
+
+/*
+ * Look up a key in the whole config string before it has been split into
+ * platform devices, e.g. "core.0.0.isa" from time_init(). Like
+ * config_string_str(), but a missing key only yields an empty value.
+ */
+int __init config_string_early_str(const char *key, char *dest, int maxlen)
+{
+	unsigned long size = sbi_config_string_size();
+	const char *start, *end, *value;
+	int len = 0;
+
+	start = (const char __force *)ioremap(sbi_config_string_base(), size);
+	if (start) {
+		end = start + size - 1; // remove null terminator
+		value = find_key(start, end, key, 1);
+		if (end - value > 0 && *value != '}')
+			len = parse_string(value, dest, maxlen);
+		iounmap((void __iomem __force *)start);
+	}
+
+	if (!len && maxlen) *dest = 0;
+	return len;
+}
+
 /* Keywords for linux resources */
 static const char interface[] = "interface";
 static const char irq[] = "irq";
@@ -3,6 +3,8 @@
 #include <linux/seq_file.h>
 #include <linux/types.h>
 #include <linux/uaccess.h> 
+#include <linux/sched.h>
+#include <linux/slab.h>
 
 #include <asm/ptrace.h>
 #include <asm/sbi.h>
@@ -11,23 +13,79 @@
 #include <asm/config-string.h>
 
 #include "flash.h"
+#include "frenox_irq.h"
+
+/* Status poll interval used when the controller has no completion interrupt */
+#define FLASH_POLL_INTERVAL     msecs_to_jiffies(10)
+
 struct t_flash_memory {
     volatile unsigned long * control;
     volatile unsigned long * data;
+    struct frenox_irq irq;      // completion interrupt, rearmed by waiters
 }; // TODO: Make linked list and store in private_data on open()
 static struct t_flash_memory flash_memory;
 
+/* Per open file state */
+struct t_flash_file {
+    unsigned int irq_seen;      // irq count last reported to this file
+};
+
+struct t_flash_done {
+    struct t_flash_memory *flash;
+    struct flash_wait *w;
+};
+
+static bool flash_done(void *data)
+{
+    struct t_flash_done *d = data;
+
+    return (d->flash->control[d->w->address/sizeof(unsigned long)] & d->w->mask) == d->w->value;
+}
+
+/* Sleep until an erase/program operation reports completion */
+static long flash_wait(struct t_flash_memory *flash, struct flash_wait *w)
+{
+    struct t_flash_done d = { .flash = flash, .w = w };
+
+    return frenox_irq_wait(&flash->irq, flash_done, &d, w->timeout, FLASH_POLL_INTERVAL);
+}
+
 int flash_open(struct inode *inode, struct file *filp) {
+    struct t_flash_file *p_file;
+
+    p_file = kzalloc(sizeof(*p_file), GFP_KERNEL);
+    if (p_file == NULL) return -ENOMEM;
+
+    p_file->irq_seen = frenox_irq_count(&flash_memory.irq);
+    filp->private_data = p_file;
+
     return 0;
 }
 
 int flash_close(struct inode *inode, struct file *filp) {
+    kfree(filp->private_data);
     return 0;
 }
 
+/* Blocking read of the completion interrupt count (u32) */
+static ssize_t flash_read(struct file *filp, char __user *buf, size_t count, loff_t *ppos)
+{
+    struct t_flash_file *p_file = filp->private_data;
+
+    return frenox_irq_read(&flash_memory.irq, &p_file->irq_seen, filp, buf, count);
+}
+
+static unsigned int flash_poll(struct file *filp, poll_table *wait)
+{
+    struct t_flash_file *p_file = filp->private_data;
+
+    return frenox_irq_poll(&flash_memory.irq, p_file->irq_seen, filp, wait);
+}
+
 static long flash_ioctl(struct file *p_file, unsigned int num, unsigned long param)
 {
     struct flash_regmap * user_regmap;
+    struct flash_wait wait;
     ssize_t address;
     unsigned long data;
     switch(num) {
@@ -55,6 +113,10 @@ static long flash_ioctl(struct file *p_file, unsigned int num, unsigned long par
         get_user(data, &user_regmap->data);
         flash_memory.data[address/sizeof(data)] = data;
         return 0;
+    case CONTROL_WAIT:
+        if (copy_from_user(&wait, (void __user *)param, sizeof(wait)))
+            return -EFAULT;
+        return flash_wait(&flash_memory, &wait);
     }
 
     return -EINVAL;
@@ -63,6 +125,8 @@ static long flash_ioctl(struct file *p_file, unsigned int num, unsigned long par
 /** Register module file operation functions */
 static struct file_operations flash_fops = {
   open:             flash_open,
+  read:             flash_read,
+  poll:             flash_poll,
   unlocked_ioctl:   flash_ioctl,
   release:          flash_close
 };
@@ -71,6 +135,7 @@ static int flash_probe(struct platform_device *pdev)
 {
     struct resource *res;
     void *base;
+    int err;
     
     res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
     base = devm_ioremap_resource(&pdev->dev, res);
@@ -89,6 +154,16 @@ static int flash_probe(struct platform_device *pdev)
     }
     printk(KERN_INFO "Flash data memory address: 0x%08X\n", base); 
     flash_memory.data = base;
+
+    frenox_irq_init(&flash_memory.irq, true);
+
+    // Completion interrupt is optional, fall back to polling without it
+    res = platform_get_resource(pdev, IORESOURCE_IRQ, 0);
+    if (res) {
+        err = frenox_irq_request(&pdev->dev, &flash_memory.irq, res->start, FLASH_NAME);
+        if (err)
+            dev_warn(&pdev->dev, "Unable to request irq %d, polling status\n", (int)res->start);
+    }
     
     // Register module major
     return register_chrdev(FLASH_MAJOR, FLASH_NAME, &flash_fops);
@@ -28,6 +28,14 @@ struct flash_regmap {
     uint32_t data;
 };
 
+/* Wait until (control[address] & mask) == value, or timeout (ms, 0 = forever) */
+struct flash_wait {
+    uint32_t address;
+    uint32_t mask;
+    uint32_t value;
+    uint32_t timeout;
+};
+
 #define FLASH_MAJOR     188
 #define FLASH_NAME      "flash"
 
@@ -35,6 +43,7 @@ struct flash_regmap {
 #define CONTROL_WRITE   _IOW(FLASH_MAJOR, 1, int)
 #define DATA_READ       _IOWR(FLASH_MAJOR, 2, int)
 #define DATA_WRITE      _IOW(FLASH_MAJOR, 3, int)
+#define CONTROL_WAIT    _IOW(FLASH_MAJOR, 4, struct flash_wait)
 
 
 #endif /* FLASH_H */
@@ -0,0 +1,158 @@
+#include <linux/interrupt.h>
+#include <linux/jiffies.h>
+#include <linux/sched.h>
+#include <linux/types.h>
+#include <linux/uaccess.h>
+
+#include "frenox_irq.h"
+
+static irqreturn_t frenox_irq_isr(int irq, void *p_data)
+{
+    struct frenox_irq *p_irq = p_data;
+
+    spin_lock(&p_irq->lock);
+    if (p_irq->enabled) {
+        disable_irq_nosync(irq);
+        p_irq->enabled = false;
+    }
+    spin_unlock(&p_irq->lock);
+
+    atomic_inc(&p_irq->count);
+    wake_up_interruptible(&p_irq->wait);
+
+    return IRQ_HANDLED;
+}
+
+void frenox_irq_init(struct frenox_irq *p_irq, bool rearm_on_wait)
+{
+    p_irq->irq = -1;
+    p_irq->enabled = false;
+    p_irq->rearm_on_wait = rearm_on_wait;
+    atomic_set(&p_irq->count, 0);
+    spin_lock_init(&p_irq->lock);
+    init_waitqueue_head(&p_irq->wait);
+}
+
+int frenox_irq_request(struct device *p_dev, struct frenox_irq *p_irq, unsigned int irq, const char *name)
+{
+    int ret;
+
+    p_irq->enabled = true;
+    ret = devm_request_irq(p_dev, irq, frenox_irq_isr, 0, name, p_irq);
+    if (ret) {
+        p_irq->enabled = false;
+        return ret;
+    }
+    p_irq->irq = irq;
+
+    return 0;
+}
+
+void frenox_irq_free(struct device *p_dev, struct frenox_irq *p_irq)
+{
+    if (p_irq->irq < 0) return;
+
+    devm_free_irq(p_dev, p_irq->irq, p_irq);
+    p_irq->irq = -1;
+}
+
+void frenox_irq_rearm(struct frenox_irq *p_irq)
+{
+    unsigned long flags;
+
+    if (p_irq->irq < 0) return;
+
+    spin_lock_irqsave(&p_irq->lock, flags);
+    if (!p_irq->enabled) {
+        p_irq->enabled = true;
+        enable_irq(p_irq->irq);
+    }
+    spin_unlock_irqrestore(&p_irq->lock, flags);
+}
+
+/*
+ * Blocking read of the interrupt count (u32). *p_seen is the count last
+ * returned to this file; the interrupt is only rearmed once that count has
+ * been consumed.
+ */
+ssize_t frenox_irq_read(struct frenox_irq *p_irq, unsigned int *p_seen, struct file *p_file,
+                        char __user *p_buf, size_t count)
+{
+    unsigned int irq_count;
+    int ret;
+
+    if (p_irq->irq < 0) return -EIO;
+    if (count < sizeof(u32)) return -EINVAL;
+
+    for (;;) {
+        irq_count = frenox_irq_count(p_irq);
+        if (irq_count != *p_seen) break;
+        if (p_file->f_flags & O_NONBLOCK) return -EAGAIN;
+
+        if (p_irq->rearm_on_wait) frenox_irq_rearm(p_irq);
+        ret = wait_event_interruptible(p_irq->wait, frenox_irq_count(p_irq) != *p_seen);
+        if (ret) return ret;
+    }
+
+    if (put_user(irq_count, (u32 __user *)p_buf)) return -EFAULT;
+    *p_seen = irq_count;
+
+    return sizeof(u32);
+}
+
+unsigned int frenox_irq_poll(struct frenox_irq *p_irq, unsigned int seen, struct file *p_file,
+                             poll_table *p_wait)
+{
+    if (p_irq->irq < 0) return POLLERR;
+
+    poll_wait(p_file, &p_irq->wait, p_wait);
+    if (frenox_irq_count(p_irq) != seen)
+        return POLLIN | POLLRDNORM;
+
+    if (p_irq->rearm_on_wait) frenox_irq_rearm(p_irq);
+    return 0;
+}
+
+/*
+ * Sleep until done() returns true, or timeout (ms, 0 = forever). Each
+ * interrupt triggers a check; without an interrupt done() is re-checked
+ * every poll_interval jiffies.
+ *
+ * The interrupt is only rearmed once the last one has been consumed and
+ * done() re-checked. If it fired but done() is still false the source is
+ * asserted for some other reason and stays so until user space clears it,
+ * rearming would just make it fire again, so poll instead.
+ */
+long frenox_irq_wait(struct frenox_irq *p_irq, bool (*done)(void *), void *p_data,
+                     unsigned long timeout, unsigned long poll_interval)
+{
+    unsigned long deadline = 0, step;
+    unsigned int seen;
+    bool polling = p_irq->irq < 0;
+    long ret;
+
+    if (timeout)
+        deadline = jiffies + msecs_to_jiffies(timeout);
+
+    for (;;) {
+        seen = frenox_irq_count(p_irq);
+        if (done(p_data)) return 0;
+        if (!polling) frenox_irq_rearm(p_irq);
+
+        if (timeout) {
+            if (time_after_eq(jiffies, deadline)) return -ETIMEDOUT;
+            step = deadline - jiffies;
+        } else {
+            step = MAX_SCHEDULE_TIMEOUT;
+        }
+        if (polling && step > poll_interval)
+            step = poll_interval;
+
+        ret = wait_event_interruptible_timeout(p_irq->wait, frenox_irq_count(p_irq) != seen, step);
+        if (ret < 0) return ret;
+
+        // Interrupt seen but still not done: the source stays asserted, poll
+        if (frenox_irq_count(p_irq) != seen && !done(p_data))
+            polling = true;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef FRENOX_IRQ_H
+#define FRENOX_IRQ_H
+
+#include <linux/atomic.h>
+#include <linux/device.h>
+#include <linux/fs.h>
+#include <linux/poll.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+/*
+ * UIO style interrupt delivery shared by the Frenox user space drivers. The
+ * interrupt is level triggered and only user space knows how to clear the
+ * device, so the ISR masks it, counts it and wakes up waiters. It stays
+ * masked until frenox_irq_rearm().
+ */
+struct frenox_irq {
+    int irq;                    // device interrupt, -1 if none
+    bool enabled;               // cleared by the ISR, set by frenox_irq_rearm()
+    bool rearm_on_wait;         // rearm when read()/poll() find nothing new
+    atomic_t count;             // number of interrupts so far
+    spinlock_t lock;
+    wait_queue_head_t wait;
+};
+
+void frenox_irq_init(struct frenox_irq *p_irq, bool rearm_on_wait);
+int frenox_irq_request(struct device *p_dev, struct frenox_irq *p_irq, unsigned int irq, const char *name);
+void frenox_irq_free(struct device *p_dev, struct frenox_irq *p_irq);
+void frenox_irq_rearm(struct frenox_irq *p_irq);
+
+static inline unsigned int frenox_irq_count(struct frenox_irq *p_irq)
+{
+    return atomic_read(&p_irq->count);
+}
+
+ssize_t frenox_irq_read(struct frenox_irq *p_irq, unsigned int *p_seen, struct file *p_file,
+                        char __user *p_buf, size_t count);
+unsigned int frenox_irq_poll(struct frenox_irq *p_irq, unsigned int seen, struct file *p_file,
+                             poll_table *p_wait);
+long frenox_irq_wait(struct frenox_irq *p_irq, bool (*done)(void *), void *p_data,
+                     unsigned long timeout, unsigned long poll_interval);
+
+#endif /* FRENOX_IRQ_H */
@@ -2,6 +2,11 @@
 #include <linux/ftrace.h>
 #include <linux/seq_file.h>
 #include <linux/types.h>
+#include <linux/moduleparam.h>
+#include <linux/debugfs.h>
+#include <linux/cpu.h>
+#include <linux/slab.h>
+#include <linux/irqdomain.h>
 
 #include <asm/ptrace.h>
 #include <asm/sbi.h>
@@ -16,49 +21,541 @@ struct plic_context {
 
 /* There can only be one PLIC per coreplex, so statically allocate it. */
 static int plic_irqs;
+static struct irq_domain *plic_domain;
 static DEFINE_PER_CPU(struct plic_context *, plic_context);
 
+/*
+ * The source priorities and the per-hart enable bits are optional in the
+ * config string. When both are described they are programmed directly;
+ * otherwise masking falls back to the SBI, which traps into machine mode.
+ */
+static volatile u32 *plic_priority;
+static DEFINE_PER_CPU(volatile u32 *, plic_enable);
+static DEFINE_RAW_SPINLOCK(plic_enable_lock);
+static int plic_hart;
+static bool plic_direct;
+
+/*
+ * Each source is enabled in exactly one hart context, so the PLIC delivers it
+ * to that hart only. plic_irq_hart[] records the target per source and
+ * plic_harts the harts that have both a context and enable registers.
+ */
+static int *plic_irq_hart;
+static struct cpumask plic_harts;
+
+/*
+ * A hart only takes sources whose priority exceeds its context threshold,
+ * and a claim returns the highest priority source pending. Priorities come
+ * from the optional "prio.<source>" config string keys and can be changed
+ * later through the "priority" and "threshold" sysfs groups.
+ */
+static unsigned int plic_max_priority;
+static struct attribute_group plic_priority_group = { .name = "priority" };
+static struct attribute_group plic_threshold_group = { .name = "threshold" };
+
+/*
+ * Upper bound on the IRQs served per trap, so that the interrupted context
+ * still makes progress under an interrupt storm. Anything left pending
+ * simply traps again.
+ */
+static unsigned int plic_max_claims = 16;
+module_param_named(max_claims, plic_max_claims, uint, 0644);
+
+/* Histogram of IRQs served per trap; the last bucket counts the rest */
+#define PLIC_CLAIM_BUCKETS	17
+static DEFINE_PER_CPU(unsigned long [PLIC_CLAIM_BUCKETS], plic_claim_stats);
+static struct dentry *plic_debugfs;
+
+#ifdef CONFIG_PLIC_LATENCY_STATS
+/*
+ * Latencies per source and hart in rdtime ticks: trap entry to claim, claim
+ * to handler return, and trap entry to completion. Bucket n of a histogram
+ * counts latencies below 2^n ticks.
+ */
+enum { PLIC_LAT_CLAIM, PLIC_LAT_HANDLER, PLIC_LAT_TOTAL, PLIC_LAT_KINDS };
+#define PLIC_LAT_BUCKETS	32
+
+struct plic_latency {
+	unsigned long hist[PLIC_LAT_KINDS][PLIC_LAT_BUCKETS];
+	cycles_t max[PLIC_LAT_KINDS];
+};
+
+DEFINE_PER_CPU(cycles_t, plic_trap_entry);	/* written by do_IRQ */
+static DEFINE_PER_CPU(cycles_t, plic_handler_return);
+static DEFINE_PER_CPU(struct plic_latency *, plic_latency);
+
+static void plic_latency_add(struct plic_latency *lat, int kind, cycles_t delta)
+{
+	lat->hist[kind][min_t(unsigned int, fls64(delta), PLIC_LAT_BUCKETS - 1)]++;
+	if (delta > lat->max[kind])
+		lat->max[kind] = delta;
+}
+
+static void plic_latency_record(unsigned int cpu, unsigned int hwirq, cycles_t claimed)
+{
+	struct plic_latency *lat = per_cpu(plic_latency, cpu);
+	cycles_t entry = per_cpu(plic_trap_entry, cpu);
+
+	if (!lat)
+		return;
+
+	lat += hwirq;
+	plic_latency_add(lat, PLIC_LAT_CLAIM, claimed - entry);
+	plic_latency_add(lat, PLIC_LAT_HANDLER, per_cpu(plic_handler_return, cpu) - claimed);
+	plic_latency_add(lat, PLIC_LAT_TOTAL, get_cycles() - entry);
+}
+#endif /* CONFIG_PLIC_LATENCY_STATS */
+
 void plic_interrupt(void)
 {
-	unsigned int cpu, irq;
+	unsigned int cpu, hwirq, served, max_claims;
 	struct plic_context *plic;
+#ifdef CONFIG_PLIC_LATENCY_STATS
+	cycles_t claimed;
+#endif
 
 	cpu = smp_processor_id();
 	plic = per_cpu(plic_context, cpu);
 
 	if (plic) {
-		/* Atomically claim the IRQ */
-		irq = plic->claim;
-		if (irq) {
-			generic_handle_irq(irq-1); /* PLIC counts from 1 */
-			plic->claim = irq;
-		}
+		max_claims = READ_ONCE(plic_max_claims);
+		served = 0;
+
+		/*
+		 * Drain everything pending instead of taking a trap for each.
+		 * The claim doubles as the ack; plic_irq_eoi() completes it.
+		 */
+		do {
+			hwirq = plic->claim;
+			if (!hwirq)
+				break;
+			if (hwirq > plic_irqs) {
+				plic->claim = hwirq;
+				continue;
+			}
+#ifdef CONFIG_PLIC_LATENCY_STATS
+			claimed = get_cycles();
+			generic_handle_irq(irq_linear_revmap(plic_domain, hwirq));
+			plic_latency_record(cpu, hwirq, claimed);
+#else
+			generic_handle_irq(irq_linear_revmap(plic_domain, hwirq));
+#endif
+		} while (++served < max_claims);
+
+		per_cpu(plic_claim_stats, cpu)[min_t(unsigned int, served, PLIC_CLAIM_BUCKETS - 1)]++;
 	}
 }
 EXPORT_SYMBOL_GPL(plic_interrupt)
 
+#ifdef CONFIG_DEBUG_FS
+static int plic_claims_show(struct seq_file *m, void *v)
+{
+	int cpu, i;
+
+	seq_printf(m, "served/trap");
+	for_each_online_cpu(cpu)
+		seq_printf(m, " %10s%d", "CPU", cpu);
+	seq_printf(m, "\n");
+
+	for (i = 0; i < PLIC_CLAIM_BUCKETS; ++i) {
+		seq_printf(m, "%10d%s", i, i == PLIC_CLAIM_BUCKETS - 1 ? "+" : " ");
+		for_each_online_cpu(cpu)
+			seq_printf(m, " %11lu", per_cpu(plic_claim_stats, cpu)[i]);
+		seq_printf(m, "\n");
+	}
+
+	return 0;
+}
+
+static int plic_claims_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, plic_claims_show, NULL);
+}
+
+static const struct file_operations plic_claims_fops = {
+	.open		= plic_claims_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+#ifdef CONFIG_PLIC_LATENCY_STATS
+static int plic_latency_show(struct seq_file *m, void *v)
+{
+	static const char * const kinds[PLIC_LAT_KINDS] = { "claim", "handler", "total" };
+	struct plic_latency *lat;
+	int cpu, hwirq, kind, i;
+
+	seq_printf(m, "# rdtime ticks at %lu Hz, bucket <2^n counts latencies below 2^n\n",
+		   sbi_timebase());
+	seq_printf(m, "#  irq hart kind           max buckets\n");
+
+	for (hwirq = 1; hwirq <= plic_irqs; ++hwirq) {
+		for_each_online_cpu(cpu) {
+			lat = per_cpu(plic_latency, cpu);
+			if (!lat || !lat[hwirq].max[PLIC_LAT_TOTAL])
+				continue;
+			lat += hwirq;
+
+			for (kind = 0; kind < PLIC_LAT_KINDS; ++kind) {
+				seq_printf(m, "%6u %4d %-7s %10llu",
+					   irq_linear_revmap(plic_domain, hwirq), cpu,
+					   kinds[kind], (unsigned long long)lat->max[kind]);
+				for (i = 0; i < PLIC_LAT_BUCKETS; ++i) {
+					if (lat->hist[kind][i])
+						seq_printf(m, " <2^%d:%lu", i, lat->hist[kind][i]);
+				}
+				seq_printf(m, "\n");
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int plic_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, plic_latency_show, NULL);
+}
+
+/* Any write starts a new measurement */
+static ssize_t plic_latency_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		if (per_cpu(plic_latency, cpu))
+			memset(per_cpu(plic_latency, cpu), 0,
+			       (plic_irqs + 1) * sizeof(struct plic_latency));
+	}
+
+	return count;
+}
+
+static const struct file_operations plic_latency_fops = {
+	.open		= plic_latency_open,
+	.read		= seq_read,
+	.write		= plic_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void plic_latency_init(struct device *dev)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		if (!per_cpu(plic_context, cpu))
+			continue;
+		per_cpu(plic_latency, cpu) = devm_kcalloc(dev, plic_irqs + 1,
+			sizeof(struct plic_latency), GFP_KERNEL);
+	}
+
+	debugfs_create_file("latency", S_IRUGO | S_IWUSR, plic_debugfs, NULL,
+			    &plic_latency_fops);
+}
+#endif /* CONFIG_PLIC_LATENCY_STATS */
+
+static void plic_debugfs_init(struct device *dev)
+{
+	plic_debugfs = debugfs_create_dir("plic", NULL);
+	if (IS_ERR_OR_NULL(plic_debugfs))
+		return;
+
+	debugfs_create_file("claims", S_IRUGO, plic_debugfs, NULL, &plic_claims_fops);
+#ifdef CONFIG_PLIC_LATENCY_STATS
+	plic_latency_init(dev);
+#endif
+}
+#else
+static inline void plic_debugfs_init(struct device *dev) { }
+#endif /* CONFIG_DEBUG_FS */
+
+static void plic_toggle(int hart, unsigned int hwirq, int enable)
+{
+	volatile u32 *reg = per_cpu(plic_enable, hart) + hwirq / 32;
+	u32 bit = 1 << (hwirq % 32);
+	unsigned long flags;
+
+	/* The enable words are shared between sources, so serialize the RMW */
+	raw_spin_lock_irqsave(&plic_enable_lock, flags);
+	if (enable)
+		*reg |= bit;
+	else
+		*reg &= ~bit;
+	raw_spin_unlock_irqrestore(&plic_enable_lock, flags);
+}
+
 static void plic_irq_mask(struct irq_data *d)
 {
+	if (plic_direct) {
+		plic_toggle(plic_irq_hart[d->hwirq], d->hwirq, 0);
+		return;
+	}
+
 	/* mask PLIC via SBI */
-	if (sbi_mask_interrupt(d->irq + 1)) // compensate for the fact that interrupt 0 is not allowed
+	if (sbi_mask_interrupt(d->hwirq))
 	    printk(KERN_ERR "Plic: Illegal irq number when masking\n");
 }
 
 static void plic_irq_unmask(struct irq_data *d)
 {
+	if (plic_direct) {
+		plic_toggle(plic_irq_hart[d->hwirq], d->hwirq, 1);
+		return;
+	}
+
 	/* unmask PLIC via SBI */
-    if (sbi_unmask_interrupt(d->irq + 1)) // compensate forthe fact that interrupt 0 is not allowed
-        printk(KERN_ERR "Plic: Illegal irq number when unmasking\n");
+	if (sbi_unmask_interrupt(d->hwirq))
+		printk(KERN_ERR "Plic: Illegal irq number when unmasking\n");
+}
+
+/*
+ * Completion goes to the context of the hart that claimed the source, and
+ * the PLIC ignores it unless the source is enabled in that context. A
+ * source masked while in flight (a lazy disable_irq_nosync()) or moved to
+ * another hart since the claim would then stay claimed for good, so enable
+ * it here just for the completion. The irq_desc lock, held here as well as
+ * around mask and set_affinity, keeps that state stable.
+ */
+static void plic_irq_eoi(struct irq_data *d)
+{
+	struct plic_context *plic = this_cpu_read(plic_context);
+	int cpu = smp_processor_id();
+
+#ifdef CONFIG_PLIC_LATENCY_STATS
+	__this_cpu_write(plic_handler_return, get_cycles());
+#endif
+	if (plic_direct &&
+	    (irqd_irq_masked(d) || plic_irq_hart[d->hwirq] != cpu)) {
+		plic_toggle(cpu, d->hwirq, 1);
+		plic->claim = d->hwirq;
+		plic_toggle(cpu, d->hwirq, 0);
+		return;
+	}
+
+	plic->claim = d->hwirq;
+}
+
+#ifdef CONFIG_SMP
+static int plic_irq_set_affinity(struct irq_data *d, const struct cpumask *mask,
+				 bool force)
+{
+	struct cpumask targets;
+	int hart, old;
+
+	/* Without enable registers the SBI decides where sources go */
+	if (!plic_direct)
+		return -EINVAL;
+
+	cpumask_and(&targets, mask, &plic_harts);
+	if (!force)
+		cpumask_and(&targets, &targets, cpu_online_mask);
+	hart = cpumask_first(&targets);
+	if (hart >= nr_cpu_ids)
+		return -EINVAL;
+
+	/*
+	 * Move the enable bit over, unless the source is masked anyway. A
+	 * claim still in flight on the old hart is completed there by
+	 * plic_irq_eoi(), which re-enables the source in that context for
+	 * the completion, so it does not stay claimed.
+	 */
+	old = plic_irq_hart[d->hwirq];
+	if (hart != old) {
+		if (!irqd_irq_masked(d)) {
+			plic_toggle(old, d->hwirq, 0);
+			plic_toggle(hart, d->hwirq, 1);
+		}
+		plic_irq_hart[d->hwirq] = hart;
+	}
+
+	cpumask_copy(irq_data_get_affinity_mask(d), cpumask_of(hart));
+	return IRQ_SET_MASK_OK_DONE;
 }
+#endif
 
 static struct irq_chip plic_irq_chip = {
 	.name		= "riscv",
 	.irq_mask	= plic_irq_mask,
 	.irq_unmask	= plic_irq_unmask,
+	.irq_eoi	= plic_irq_eoi,
+#ifdef CONFIG_SMP
+	.irq_set_affinity = plic_irq_set_affinity,
+#endif
+};
+
+static int plic_irq_map(struct irq_domain *d, unsigned int irq,
+			irq_hw_number_t hwirq)
+{
+	irq_set_chip_and_handler(irq, &plic_irq_chip, handle_fasteoi_irq);
+	return 0;
+}
+
+static const struct irq_domain_ops plic_irq_domain_ops = {
+	.map	= plic_irq_map,
+	.xlate	= irq_domain_xlate_onecell,
+};
+
+static ssize_t plic_priority_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct dev_ext_attribute *ea = container_of(attr, struct dev_ext_attribute, attr);
+
+	return sprintf(buf, "%u\n", plic_priority[(long)ea->var]);
+}
+
+static ssize_t plic_priority_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct dev_ext_attribute *ea = container_of(attr, struct dev_ext_attribute, attr);
+	unsigned int prio;
+	int err;
+
+	err = kstrtouint(buf, 0, &prio);
+	if (err)
+		return err;
+	if (prio > plic_max_priority)
+		return -EINVAL;
+
+	plic_priority[(long)ea->var] = prio;
+	return count;
+}
+
+static ssize_t plic_threshold_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct dev_ext_attribute *ea = container_of(attr, struct dev_ext_attribute, attr);
+
+	return sprintf(buf, "%u\n", per_cpu(plic_context, (long)ea->var)->priority_threshold);
+}
+
+static ssize_t plic_threshold_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct dev_ext_attribute *ea = container_of(attr, struct dev_ext_attribute, attr);
+	unsigned int threshold;
+	int err;
+
+	err = kstrtouint(buf, 0, &threshold);
+	if (err)
+		return err;
+	if (threshold > plic_max_priority)
+		return -EINVAL;
+
+	per_cpu(plic_context, (long)ea->var)->priority_threshold = threshold;
+	return count;
+}
+
+static struct attribute *plic_sysfs_attr(struct device *dev, long name, long index,
+	ssize_t (*show)(struct device *, struct device_attribute *, char *),
+	ssize_t (*store)(struct device *, struct device_attribute *, const char *, size_t))
+{
+	struct dev_ext_attribute *ea;
+
+	ea = devm_kzalloc(dev, sizeof(*ea), GFP_KERNEL);
+	if (!ea)
+		return NULL;
+
+	ea->attr.attr.name = devm_kasprintf(dev, GFP_KERNEL, "%ld", name);
+	if (!ea->attr.attr.name)
+		return NULL;
+
+	sysfs_attr_init(&ea->attr.attr);
+	ea->attr.attr.mode = S_IRUGO | S_IWUSR;
+	ea->attr.show = show;
+	ea->attr.store = store;
+	ea->var = (void *)index;
+
+	return &ea->attr.attr;
+}
+
+/* priority/<irq> per source (named like /proc/irq) and threshold/<hart> */
+static int plic_sysfs_init(struct device *dev)
+{
+	struct attribute **attrs;
+	int hart, hwirq, n, err;
+
+	if (plic_priority) {
+		attrs = devm_kcalloc(dev, plic_irqs + 1, sizeof(*attrs), GFP_KERNEL);
+		if (!attrs)
+			return -ENOMEM;
+
+		for (hwirq = 1; hwirq <= plic_irqs; ++hwirq) {
+			attrs[hwirq - 1] = plic_sysfs_attr(dev,
+				irq_linear_revmap(plic_domain, hwirq), hwirq,
+				plic_priority_show, plic_priority_store);
+			if (!attrs[hwirq - 1])
+				return -ENOMEM;
+		}
+
+		plic_priority_group.attrs = attrs;
+		err = sysfs_create_group(&dev->kobj, &plic_priority_group);
+		if (err) {
+			plic_priority_group.attrs = NULL;
+			return err;
+		}
+	}
+
+	attrs = devm_kcalloc(dev, nr_cpu_ids + 1, sizeof(*attrs), GFP_KERNEL);
+	if (!attrs)
+		return -ENOMEM;
+
+	n = 0;
+	for_each_cpu(hart, cpu_possible_mask) {
+		if (!per_cpu(plic_context, hart))
+			continue;
+		attrs[n] = plic_sysfs_attr(dev, hart, hart,
+			plic_threshold_show, plic_threshold_store);
+		if (!attrs[n++])
+			return -ENOMEM;
+	}
+
+	plic_threshold_group.attrs = attrs;
+	err = sysfs_create_group(&dev->kobj, &plic_threshold_group);
+	if (err)
+		plic_threshold_group.attrs = NULL;
+	return err;
+}
+
+static void plic_hart_enable(void *unused)
+{
+	csr_set(sie, SIE_SEIE);
+}
+
+static void plic_hart_disable(void *unused)
+{
+	csr_clear(sie, SIE_SEIE);
+}
+
+/*
+ * Harts brought up after probe must take external interrupts as well; a
+ * hart going offline has had its interrupts migrated away already.
+ */
+static int plic_cpu_notify(struct notifier_block *self, unsigned long action,
+			   void *hcpu)
+{
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_STARTING:
+		plic_hart_enable(NULL);
+		break;
+	case CPU_DYING:
+		plic_hart_disable(NULL);
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block plic_cpu_notifier = {
+	.notifier_call = plic_cpu_notify,
 };
 
 static int plic_probe(struct platform_device *pdev)
 {
+	unsigned int prio;
 	int hart, irq;
 	struct resource *res;
 	void *plic;
@@ -73,13 +570,30 @@ static int plic_probe(struct platform_device *pdev)
 		return -ENODEV;
 	}
 
-	for (irq = 0; irq < plic_irqs; ++irq) {
-		irq_set_chip_and_handler(irq, &plic_irq_chip, handle_simple_irq);
+	plic_irq_hart = devm_kcalloc(&pdev->dev, plic_irqs + 1, sizeof(*plic_irq_hart),
+				     GFP_KERNEL);
+	if (!plic_irq_hart) {
+		irq_free_descs(0, plic_irqs);
+		return -ENOMEM;
+	}
+
+	/*
+	 * Source 0 does not exist, so Linux irq N stays PLIC source N+1 as the
+	 * config string expects. Cascaded controllers get IRQs above these.
+	 */
+	plic_domain = irq_domain_add_legacy(NULL, plic_irqs, 0, 1,
+					    &plic_irq_domain_ops, NULL);
+	if (!plic_domain) {
+		dev_err(&pdev->dev, "could not create PLIC irq domain\n");
+		irq_free_descs(0, plic_irqs);
+		return -ENOMEM;
 	}
 
 	/* Configure the base addresses for the PLIC */
+	cpumask_clear(&plic_harts);
 	for_each_cpu(hart, cpu_possible_mask) {
 		per_cpu(plic_context, hart) = 0;
+		per_cpu(plic_enable, hart) = 0;
 
 		sprintf(name, "%d.%d", 0, hart);
 		res = platform_get_resource_byname(pdev, IORESOURCE_MEM, name);
@@ -95,11 +609,79 @@ static int plic_probe(struct platform_device *pdev)
 		}
 
 		per_cpu(plic_context, hart) = plic;
+		per_cpu(plic_context, hart)->priority_threshold = 0;
+
+		sprintf(name, "%d.%d.ie", 0, hart);
+		res = platform_get_resource_byname(pdev, IORESOURCE_MEM, name);
+		if (!res)
+			continue;
+
+		plic = devm_ioremap_resource(&pdev->dev, res);
+		if (IS_ERR(plic)) {
+			dev_warn(&pdev->dev, "could not map PLIC enables for hart %d\n", hart);
+			continue;
+		}
+
+		per_cpu(plic_enable, hart) = plic;
+		cpumask_set_cpu(hart, &plic_harts);
 	}
 
-	/* Enable external interrupts */
+	/* Program priorities and enables directly if they are described */
+	plic_priority = 0;
+	res = platform_get_resource_byname(pdev, IORESOURCE_MEM, "priority");
+	if (res) {
+		plic = devm_ioremap_resource(&pdev->dev, res);
+		if (!IS_ERR(plic))
+			plic_priority = plic;
+	}
+
+	/* Everything starts out on the boot hart; irqbalance spreads it later */
+	plic_hart = cpumask_first(cpu_online_mask);
+	plic_direct = plic_priority && per_cpu(plic_enable, plic_hart);
+	for (irq = 1; irq <= plic_irqs; ++irq) {
+		plic_irq_hart[irq] = plic_hart;
+		if (!plic_direct)
+			irq_set_status_flags(irq_linear_revmap(plic_domain, irq),
+					     IRQ_NO_BALANCING);
+	}
+	if (plic_direct) {
+		for_each_cpu(hart, cpu_possible_mask) {
+			if (!per_cpu(plic_enable, hart))
+				continue;
+			for (irq = 0; irq <= plic_irqs; irq += 32)
+				per_cpu(plic_enable, hart)[irq / 32] = 0;
+		}
+	} else {
+		dev_info(&pdev->dev, "no priority/enable registers, masking through the SBI\n");
+	}
+
+	/* Without sources there is not even a priority register to probe */
+	if (plic_priority && plic_irqs > 0) {
+		/* Priorities are WARL, so the widest value sticks as the maximum */
+		plic_priority[1] = ~0U;
+		plic_max_priority = plic_priority[1];
+
+		/* Source 0 does not exist; the others default to priority 1 */
+		for (irq = 1; irq <= plic_irqs; ++irq) {
+			prio = 1;
+			sprintf(name, "prio.%d", irq);
+			if (config_string_has(pdev, name))
+				prio = min_t(u64, config_string_u64(pdev, name),
+					     plic_max_priority);
+			plic_priority[irq] = prio;
+		}
+	}
+
+	plic_debugfs_init(&pdev->dev);
+	if (plic_sysfs_init(&pdev->dev))
+		dev_warn(&pdev->dev, "could not create priority attributes\n");
+
+	/* Enable external interrupts on every hart, including late ones */
 	dev_info(&pdev->dev, "enabling %d IRQs\n", plic_irqs);
-	csr_set(sie, SIE_SEIE);
+	cpu_notifier_register_begin();
+	on_each_cpu(plic_hart_enable, NULL, 1);
+	__register_cpu_notifier(&plic_cpu_notifier);
+	cpu_notifier_register_done();
 
 	return 0;
 }
@@ -109,15 +691,38 @@ static int plic_remove(struct platform_device *pdev)
 	int hart;
 
 	/* Disable external interrupts */
-	csr_clear(sie, SIE_SEIE);
+	cpu_notifier_register_begin();
+	__unregister_cpu_notifier(&plic_cpu_notifier);
+	on_each_cpu(plic_hart_disable, NULL, 1);
+	cpu_notifier_register_done();
+
+	debugfs_remove_recursive(plic_debugfs);
+	plic_debugfs = NULL;
+
+	if (plic_priority_group.attrs)
+		sysfs_remove_group(&pdev->dev.kobj, &plic_priority_group);
+	if (plic_threshold_group.attrs)
+		sysfs_remove_group(&pdev->dev.kobj, &plic_threshold_group);
+	plic_priority_group.attrs = NULL;
+	plic_threshold_group.attrs = NULL;
 
 	/* Wipe out the global mapping table; actual unmap is automatic */
+	plic_direct = false;
+	plic_priority = 0;
+	plic_irq_hart = NULL;
+	cpumask_clear(&plic_harts);
 	for_each_cpu(hart, cpu_possible_mask) {
 		per_cpu(plic_context, hart) = 0;
+		per_cpu(plic_enable, hart) = 0;
+#ifdef CONFIG_PLIC_LATENCY_STATS
+		per_cpu(plic_latency, hart) = NULL;
+#endif
 	}
 
 	/* Release the descriptors */
 	irq_free_descs(0, plic_irqs);
+	irq_domain_remove(plic_domain);
+	plic_domain = NULL;
 
 	return 0;
 }
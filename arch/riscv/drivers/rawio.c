@@ -18,6 +18,11 @@
  *    @author Sijmen Woutersen (sijmen.woutersen@technolution.nl)
  *
  *    RAW I/O driver providing direct register access to I/O through mmap
+ *
+ *    Devices with an interrupt deliver it UIO style: the interrupt is masked
+ *    when it fires, read() blocks until it did and returns the (u32) number
+ *    of interrupts so far, and RAWIO_IRQ_ENABLE unmasks it again once user
+ *    space has serviced the device.
  */
 #include <linux/interrupt.h>
 #include <linux/ftrace.h>
@@ -27,6 +32,12 @@
 #include <linux/kernel.h>
 #include <linux/init.h>
 #include <linux/slab.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include <linux/mm.h>
+#include <linux/mman.h>
+#include <linux/mutex.h>
 
 #include <asm/ptrace.h>
 #include <asm/sbi.h>
@@ -35,6 +46,7 @@
 #include <asm/config-string.h>
 
 #include "rawio.h"
+#include "frenox_irq.h"
 
 struct rawio_t;
 
@@ -43,6 +55,24 @@ struct rawio_t {
     int index;
     struct platform_device *p_device;
     struct rawio_t *p_next;
+    struct frenox_irq irq;      ///< rearmed by RAWIO_IRQ_ENABLE only
+};
+
+/// DMA buffer (linked list item)
+struct rawio_dma_t {
+    void *p_virt;
+    size_t size;
+    unsigned long pgoff;        ///< first page in the mmap offset space
+    struct rawio_dma_t *p_next;
+};
+
+/// open file info
+struct rawio_file_t {
+    struct rawio_t *p_rawio;
+    unsigned int irq_seen;      ///< irq count last returned by read()
+    struct mutex dma_lock;
+    struct rawio_dma_t *p_dma_list; ///< buffers owned by this file
+    unsigned long dma_pgoff;    ///< next free page in the DMA offset space
 };
 
 static struct rawio_t *p_rawio_list = NULL; ///< head of linked-list containing all devices
@@ -52,32 +82,124 @@ static int rawio_open(struct inode *p_inode, struct file *p_file)
 {
     int index = MINOR(p_inode->i_rdev);
     struct rawio_t *p_rawio = p_rawio_list;
+    struct rawio_file_t *p_rawio_file;
 
     // find device
     while (p_rawio && p_rawio->index != index) p_rawio = p_rawio->p_next;
     if (p_rawio == NULL) return -ENODEV;
 
+    p_rawio_file = kcalloc(1, sizeof(struct rawio_file_t), GFP_KERNEL);
+    if (p_rawio_file == NULL) return -ENOMEM;
+
     // link file to device
-    p_file->private_data = p_rawio;
+    p_rawio_file->p_rawio = p_rawio;
+    p_rawio_file->irq_seen = frenox_irq_count(&p_rawio->irq);
+    mutex_init(&p_rawio_file->dma_lock);
+    p_rawio_file->dma_pgoff = RAWIO_DMA_OFFSET >> PAGE_SHIFT;
+    p_file->private_data = p_rawio_file;
 
     return 0;
 }
 
-static int rawio_mmap(struct file *p_file, struct vm_area_struct *p_vma)
+static ssize_t rawio_read(struct file *p_file, char __user *p_buf, size_t count, loff_t *p_pos)
 {
-    struct rawio_t *p_rawio = p_file->private_data;
-    struct resource *p_resource = platform_get_resource(p_rawio->p_device, IORESOURCE_MEM, 0);
+    struct rawio_file_t *p_rawio_file = p_file->private_data;
 
-    if (p_resource == NULL) return -ENODEV;
-    if (p_vma->vm_pgoff != 0) return -EINVAL;
-    if (((p_vma->vm_end - p_vma->vm_start) & ~PAGE_MASK) != 0) return -EINVAL;
-    if ((p_vma->vm_end - p_vma->vm_start) > p_resource->end - p_resource->start) return -EINVAL;
+    return frenox_irq_read(&p_rawio_file->p_rawio->irq, &p_rawio_file->irq_seen, p_file, p_buf, count);
+}
 
-    p_vma->vm_page_prot = pgprot_noncached(p_vma->vm_page_prot);
-    p_vma->vm_flags |= VM_IO;
+static unsigned int rawio_poll(struct file *p_file, poll_table *p_wait)
+{
+    struct rawio_file_t *p_rawio_file = p_file->private_data;
+
+    return frenox_irq_poll(&p_rawio_file->p_rawio->irq, p_rawio_file->irq_seen, p_file, p_wait);
+}
+
+/// number of pages a memory resource occupies in the mmap offset space
+static unsigned long rawio_resource_pages(struct resource *p_resource)
+{
+    return PAGE_ALIGN((p_resource->start & ~PAGE_MASK) + resource_size(p_resource)) >> PAGE_SHIFT;
+}
+
+/// find memory resource 'index' and its first page in the mmap offset space
+static struct resource *rawio_get_resource(struct rawio_t *p_rawio, unsigned int index, unsigned long *p_pgoff)
+{
+    struct resource *p_resource;
+    unsigned int i;
+
+    *p_pgoff = 0;
+    for (i = 0; (p_resource = platform_get_resource(p_rawio->p_device, IORESOURCE_MEM, i)) != NULL; i++) {
+        if (i == index) return p_resource;
+        *p_pgoff += rawio_resource_pages(p_resource);
+    }
+
+    return NULL;
+}
+
+static long rawio_dma_alloc(struct file *p_file, struct rawio_dma_buffer __user *p_user)
+{
+    struct rawio_file_t *p_rawio_file = p_file->private_data;
+    struct rawio_dma_buffer buffer;
+    struct rawio_dma_t *p_dma;
+    unsigned long addr;
+    size_t size;
+
+    if (copy_from_user(&buffer, p_user, sizeof(buffer))) return -EFAULT;
+    if (buffer.size == 0 || buffer.size > (PAGE_SIZE << (MAX_ORDER - 1))) return -EINVAL;
+    size = PAGE_ALIGN(buffer.size);
+
+    p_dma = kcalloc(1, sizeof(struct rawio_dma_t), GFP_KERNEL);
+    if (p_dma == NULL) return -ENOMEM;
+
+    p_dma->p_virt = alloc_pages_exact(size, GFP_KERNEL | __GFP_ZERO);
+    if (p_dma->p_virt == NULL) {
+        kfree(p_dma);
+        return -ENOMEM;
+    }
+    p_dma->size = size;
+
+    // owned by the file from here on, released on close
+    mutex_lock(&p_rawio_file->dma_lock);
+    p_dma->pgoff = p_rawio_file->dma_pgoff;
+    p_rawio_file->dma_pgoff += size >> PAGE_SHIFT;
+    p_dma->p_next = p_rawio_file->p_dma_list;
+    p_rawio_file->p_dma_list = p_dma;
+    mutex_unlock(&p_rawio_file->dma_lock);
 
-    if (io_remap_pfn_range(p_vma, p_vma->vm_start, p_resource->start >> PAGE_SHIFT, p_vma->vm_end - p_vma->vm_start,
-            p_vma->vm_page_prot)) {
+    addr = vm_mmap(p_file, 0, size, PROT_READ | PROT_WRITE, MAP_SHARED, p_dma->pgoff << PAGE_SHIFT);
+    if (IS_ERR_VALUE(addr)) return addr;
+
+    buffer.size = size;
+    buffer.phys = virt_to_phys(p_dma->p_virt);
+    buffer.addr = addr;
+    buffer.offset = (uint64_t)p_dma->pgoff << PAGE_SHIFT;
+    if (copy_to_user(p_user, &buffer, sizeof(buffer))) return -EFAULT;
+
+    return 0;
+}
+
+static int rawio_dma_mmap(struct rawio_file_t *p_rawio_file, struct vm_area_struct *p_vma)
+{
+    struct rawio_dma_t *p_dma;
+    unsigned long pfn = 0;
+    bool found = false;
+    unsigned long pgoff = p_vma->vm_pgoff;
+    unsigned long pages = vma_pages(p_vma);
+
+    mutex_lock(&p_rawio_file->dma_lock);
+    for (p_dma = p_rawio_file->p_dma_list; p_dma; p_dma = p_dma->p_next) {
+        if (pgoff >= p_dma->pgoff && pgoff - p_dma->pgoff < (p_dma->size >> PAGE_SHIFT)) {
+            pfn = (virt_to_phys(p_dma->p_virt) >> PAGE_SHIFT) + (pgoff - p_dma->pgoff);
+            found = pages <= (p_dma->size >> PAGE_SHIFT) - (pgoff - p_dma->pgoff);
+            break;
+        }
+    }
+    mutex_unlock(&p_rawio_file->dma_lock);
+
+    // a mapping may not extend past its buffer
+    if (!found) return -EINVAL;
+
+    if (remap_pfn_range(p_vma, p_vma->vm_start, pfn, p_vma->vm_end - p_vma->vm_start, p_vma->vm_page_prot)) {
         printk(KERN_WARNING "remap_pfn_range failed\n");
         return -EAGAIN;
     }
@@ -85,13 +207,104 @@ static int rawio_mmap(struct file *p_file, struct vm_area_struct *p_vma)
     return 0;
 }
 
+static long rawio_ioctl(struct file *p_file, unsigned int num, unsigned long param)
+{
+    struct rawio_file_t *p_rawio_file = p_file->private_data;
+    struct rawio_t *p_rawio = p_rawio_file->p_rawio;
+    struct rawio_resource query;
+    struct resource *p_resource;
+    unsigned long pgoff;
+
+    switch (num) {
+    case RAWIO_IRQ_ENABLE:
+        if (p_rawio->irq.irq < 0) return -EIO;
+        frenox_irq_rearm(&p_rawio->irq);
+        return 0;
+    case RAWIO_QUERY:
+        if (copy_from_user(&query, (void __user *)param, sizeof(query))) return -EFAULT;
+        p_resource = rawio_get_resource(p_rawio, query.index, &pgoff);
+        if (p_resource == NULL) return -ENXIO;
+        query.offset = (uint64_t)pgoff << PAGE_SHIFT;
+        query.phys = p_resource->start;
+        query.size = resource_size(p_resource);
+        if (copy_to_user((void __user *)param, &query, sizeof(query))) return -EFAULT;
+        return 0;
+    case RAWIO_DMA_ALLOC:
+        return rawio_dma_alloc(p_file, (struct rawio_dma_buffer __user *)param);
+    }
+
+    return -ENOTTY;
+}
+
+/*
+ * vm_pgoff selects the first page within the concatenated memory resources,
+ * a mapping may cover several consecutive resources.
+ */
+static int rawio_mmap(struct file *p_file, struct vm_area_struct *p_vma)
+{
+    struct rawio_file_t *p_rawio_file = p_file->private_data;
+    struct rawio_t *p_rawio = p_rawio_file->p_rawio;
+    struct resource *p_resource;
+    unsigned long pgoff = p_vma->vm_pgoff;
+    unsigned long pages = vma_pages(p_vma);
+    unsigned long addr = p_vma->vm_start;
+    unsigned long res_pgoff, res_pages, skip, count;
+    unsigned int i;
+
+    if (pgoff >= (RAWIO_DMA_OFFSET >> PAGE_SHIFT)) return rawio_dma_mmap(p_rawio_file, p_vma);
+
+    // check the whole range is backed before mapping anything
+    res_pgoff = 0;
+    for (i = 0; (p_resource = platform_get_resource(p_rawio->p_device, IORESOURCE_MEM, i)) != NULL; i++)
+        res_pgoff += rawio_resource_pages(p_resource);
+    if (res_pgoff == 0) return -ENODEV;
+    if (pgoff >= res_pgoff || pages > res_pgoff - pgoff) return -EINVAL;
+
+    p_vma->vm_page_prot = pgprot_noncached(p_vma->vm_page_prot);
+    p_vma->vm_flags |= VM_IO;
+
+    res_pgoff = 0;
+    for (i = 0; pages && (p_resource = platform_get_resource(p_rawio->p_device, IORESOURCE_MEM, i)) != NULL; i++) {
+        res_pages = rawio_resource_pages(p_resource);
+        if (pgoff < res_pgoff + res_pages) {
+            skip = pgoff - res_pgoff;
+            count = min(pages, res_pages - skip);
+            if (io_remap_pfn_range(p_vma, addr, (p_resource->start >> PAGE_SHIFT) + skip, count << PAGE_SHIFT,
+                    p_vma->vm_page_prot)) {
+                printk(KERN_WARNING "remap_pfn_range failed\n");
+                return -EAGAIN;
+            }
+            addr += count << PAGE_SHIFT;
+            pgoff += count;
+            pages -= count;
+        }
+        res_pgoff += res_pages;
+    }
+
+    return 0;
+}
+
 static int rawio_close(struct inode *inode, struct file *p_file)
 {
+    struct rawio_file_t *p_rawio_file = p_file->private_data;
+    struct rawio_dma_t *p_dma;
+
+    // mappings hold a file reference, so none of the buffers is mapped anymore
+    while ((p_dma = p_rawio_file->p_dma_list) != NULL) {
+        p_rawio_file->p_dma_list = p_dma->p_next;
+        free_pages_exact(p_dma->p_virt, p_dma->size);
+        kfree(p_dma);
+    }
+
+    kfree(p_rawio_file);
     return 0;
 }
 
 static struct file_operations rawio_fops = {
     open:             rawio_open,
+    read:             rawio_read,
+    poll:             rawio_poll,
+    unlocked_ioctl:   rawio_ioctl,
     mmap:             rawio_mmap,
     release:          rawio_close
 };
@@ -100,6 +313,8 @@ static int rawio_probe(struct platform_device *p_device)
 {
     struct rawio_t *p_rawio;
     struct resource *p_resource = platform_get_resource(p_device, IORESOURCE_MEM, 0);
+    struct resource *p_irq = platform_get_resource(p_device, IORESOURCE_IRQ, 0);
+    int ret;
 
     if (!p_resource) return -ENODEV;
 
@@ -113,6 +328,15 @@ static int rawio_probe(struct platform_device *p_device)
            (void*)p_resource->start, (void*)p_resource->end);
     p_rawio->index = index++;
     p_rawio->p_device = p_device;
+    frenox_irq_init(&p_rawio->irq, false);
+
+    if (p_irq) {
+        ret = frenox_irq_request(&p_device->dev, &p_rawio->irq, p_irq->start, RAWIO_NAME);
+        if (ret) {
+            printk(KERN_WARNING "Raw I/O #%d: cannot request irq %d (%d)\n", p_rawio->index,
+                   (int)p_irq->start, ret);
+        }
+    }
 
     // add to list
     p_rawio->p_next = p_rawio_list;
@@ -131,6 +355,7 @@ static int rawio_remove(struct platform_device *p_device)
             p_next = (*pp_rawio_list)->p_next;
             printk(KERN_INFO "Removing Raw I/O #%d\n", (*pp_rawio_list)->index);
 
+            frenox_irq_free(&p_device->dev, &(*pp_rawio_list)->irq);
             kfree(*pp_rawio_list);
             *pp_rawio_list = p_next;
         } else {
@@ -4,4 +4,39 @@
 #define RAWIO_MAJOR     189
 #define RAWIO_NAME      "rawio"
 
+/*
+ * All memory resources of a device are mmap'able. They are laid out back to
+ * back in the file offset space, each starting on a page boundary; the
+ * physical start address keeps its offset within that first page.
+ */
+struct rawio_resource {
+    uint32_t index;     /* in: resource index */
+    uint32_t reserved;
+    uint64_t offset;    /* out: mmap offset of the page containing phys */
+    uint64_t phys;      /* out: physical start address */
+    uint64_t size;      /* out: size in bytes */
+};
+
+/*
+ * Physically contiguous buffer for devices that master memory. The buffer is
+ * mapped into the caller on allocation and can be mapped again at 'offset';
+ * it is released when the file is closed.
+ */
+struct rawio_dma_buffer {
+    uint64_t size;      /* in: size in bytes, rounded up to whole pages */
+    uint64_t phys;      /* out: physical (bus) address for the device */
+    uint64_t addr;      /* out: user address of the mapping */
+    uint64_t offset;    /* out: mmap offset of the buffer */
+};
+
+/* mmap offsets from here on refer to DMA buffers instead of resources */
+#define RAWIO_DMA_OFFSET    0x40000000UL
+
+/* Re-enable the device interrupt after it fired (read() returns the count) */
+#define RAWIO_IRQ_ENABLE    _IO(RAWIO_MAJOR, 0)
+/* Describe memory resource 'index', fails with ENXIO past the last one */
+#define RAWIO_QUERY         _IOWR(RAWIO_MAJOR, 1, struct rawio_resource)
+/* Allocate and map a DMA buffer */
+#define RAWIO_DMA_ALLOC     _IOWR(RAWIO_MAJOR, 2, struct rawio_dma_buffer)
+
 #endif
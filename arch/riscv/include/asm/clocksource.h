@@ -0,0 +1,9 @@
+#ifndef _ASM_RISCV_CLOCKSOURCE_H
+#define _ASM_RISCV_CLOCKSOURCE_H
+
+/* Whether the vDSO can read this clocksource itself (rdtime) */
+struct arch_clocksource_data {
+	bool vdso_direct;
+};
+
+#endif /* _ASM_RISCV_CLOCKSOURCE_H */
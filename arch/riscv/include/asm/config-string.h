@@ -9,10 +9,24 @@
  * If there is a parsing failure, there will be a kernel warning generated.
  */
 
+/* Returns non-zero if key is present; use this for optional parameters */
+int config_string_has(struct platform_device *pdev, const char *key);
+
 /* Returns a parsed integer for the first value */
 u64 config_string_u64(struct platform_device *pdev, const char *key);
 
 /* Returns the total length of the value, writes at most maxlen bytes to dest */
 int config_string_str(struct platform_device *pdev, const char *key, char *dest, int maxlen);
 
+/* Same for the whole config string, usable before the platform devices exist */
+#ifdef CONFIG_CONFIG_STRING
+int config_string_early_str(const char *key, char *dest, int maxlen);
+#else
+static inline int config_string_early_str(const char *key, char *dest, int maxlen)
+{
+	if (maxlen) *dest = 0;
+	return 0;
+}
+#endif
+
 #endif /* __ASM_CONFIG_STRING_H */
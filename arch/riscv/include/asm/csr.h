@@ -27,6 +27,15 @@
 #define SR_SD   _AC(0x8000000000000000,UL) /* FS/XS dirty */
 #endif
 
+/* sptbr holds the root page table PPN below the ASID */
+#ifndef CONFIG_64BIT
+#define SPTBR_ASID_SHIFT 22
+#else
+#define SPTBR_ASID_SHIFT 38
+#endif
+#define SPTBR_PPN       ((_AC(1,UL) << SPTBR_ASID_SHIFT) - 1)
+#define SPTBR_ASID      (~SPTBR_PPN)
+
 /* Interrupt Enable and Interrupt Pending flags */
 #define SIE_SSIE _AC(0x00000002,UL) /* Software Interrupt Enable */
 #define SIE_STIE _AC(0x00000020,UL) /* Timer Interrupt Enable */
@@ -39,6 +48,10 @@
 #define EXC_STORE_ACCESS        7
 #define EXC_SYSCALL             8
 
+/* CSRs the assembler has no name for, use with __stringify() */
+#define CSR_STIMECMP            0x14d /* Sstc supervisor timer compare */
+#define CSR_STIMECMPH           0x15d /* upper half on rv32 */
+
 #ifndef __ASSEMBLY__
 
 #define CSR_ZIMM(val) \
@@ -9,6 +9,11 @@
 
 void riscv_timer_interrupt(void);
 
+#ifdef CONFIG_HOTPLUG_CPU
+/* Move the interrupts of a hart that is going offline to the others */
+void migrate_irqs(void);
+#endif
+
 #include <asm-generic/irq.h>
 
 #endif /* _ASM_RISCV_IRQ_H */
@@ -0,0 +1,12 @@
+#ifndef _ASM_RISCV_IRQ_WORK_H
+#define _ASM_RISCV_IRQ_WORK_H
+
+#include <linux/kconfig.h>
+
+/* arch_irq_work_raise() sends a self-IPI, which needs the SMP IPI code */
+static inline bool arch_irq_work_has_interrupt(void)
+{
+	return IS_ENABLED(CONFIG_SMP);
+}
+
+#endif /* _ASM_RISCV_IRQ_WORK_H */
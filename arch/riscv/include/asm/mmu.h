@@ -3,8 +3,17 @@
 
 #ifndef __ASSEMBLY__
 
+#include <linux/threads.h>
+#include <linux/cpumask.h>
+
 typedef struct {
 	void *vdso;
+	/* Per-hart ASID and generation, 0 if none (mm/context.c) */
+	unsigned long asid[NR_CPUS];
+#ifdef CONFIG_SMP
+	/* Harts that must fence.i before running this mm again */
+	cpumask_t icache_stale_mask;
+#endif
 } mm_context_t;
 
 #endif /* __ASSEMBLY__ */
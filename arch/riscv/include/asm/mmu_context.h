@@ -6,6 +6,14 @@
 #include <linux/mm.h>
 #include <linux/sched.h>
 #include <asm/tlbflush.h>
+#include <asm/cacheflush.h>
+
+extern unsigned long asid_bits;
+
+void asid_init(void);
+void switch_mm_context(struct mm_struct *prev, struct mm_struct *next,
+	unsigned int cpu);
+void drop_mmu_context(struct mm_struct *mm);
 
 static inline void enter_lazy_tlb(struct mm_struct *mm,
 	struct task_struct *task)
@@ -16,19 +24,44 @@ static inline void enter_lazy_tlb(struct mm_struct *mm,
 static inline int init_new_context(struct task_struct *task,
 	struct mm_struct *mm)
 {
+	/* dup_mm() copied the parent's ASIDs along with the rest */
+	memset(mm->context.asid, 0, sizeof(mm->context.asid));
 	return 0;
 }
 
+/* ASIDs are reclaimed by generation rollover, there is nothing to free */
 static inline void destroy_context(struct mm_struct *mm)
 {
 }
 
+/*
+ * Perform a deferred icache flush if flush_icache_mm() marked this hart.
+ * Called from switch_to() whenever a user task is scheduled onto the hart,
+ * since the hart may already hold the mm as its (lazy) active_mm and then
+ * switch_mm() has nothing to do.
+ */
+static inline void flush_icache_deferred(struct mm_struct *mm)
+{
+#ifdef CONFIG_SMP
+	unsigned int cpu = smp_processor_id();
+	cpumask_t *mask = &mm->context.icache_stale_mask;
+
+	if (cpumask_test_cpu(cpu, mask)) {
+		cpumask_clear_cpu(cpu, mask);
+		/* Pairs with the barrier in flush_icache_mm() */
+		smp_mb();
+		local_flush_icache_all();
+	}
+#endif
+}
+
 static inline void switch_mm(struct mm_struct *prev,
 	struct mm_struct *next, struct task_struct *task)
 {
 	if (likely(prev != next)) {
-		csr_write(sptbr, virt_to_pfn(next->pgd));
-		local_flush_tlb_all();
+		unsigned int cpu = smp_processor_id();
+
+		switch_mm_context(prev, next, cpu);
 	}
 }
 
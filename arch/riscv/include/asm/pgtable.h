@@ -46,8 +46,10 @@
 #define PAGE_SHARED		PAGE_WRITE
 #define PAGE_SHARED_EXEC	PAGE_WRITE_EXEC
 
+/* Global, so a page fence drops kernel translations whatever the ASID */
 #define PAGE_KERNEL		__pgprot(_PAGE_READ | _PAGE_WRITE |	\
-					 _PAGE_PRESENT | _PAGE_ACCESSED)
+					 _PAGE_PRESENT | _PAGE_ACCESSED |	\
+					 _PAGE_GLOBAL)
 
 #define swapper_pg_dir NULL
 
@@ -3,4 +3,8 @@
 
 #include <asm-generic/setup.h>
 
+#ifndef __ASSEMBLY__
+void riscv_sched_clock_init(void);
+#endif
+
 #endif /* _ASM_RISCV_SETUP_H */
@@ -6,8 +6,8 @@
 
 #ifdef CONFIG_SMP
 
-/* SMP initialization hook for setup_arch */
-void __init init_clockevent(void);
+/* Per-hart timer setup, also run when a hart comes back online */
+void init_clockevent(void);
 
 /* SMP initialization hook for setup_arch */
 void __init setup_smp(void);
@@ -20,6 +20,14 @@ void arch_send_call_function_single_ipi(int cpu);
 
 #define raw_smp_processor_id() (current_thread_info()->cpu)
 
+/* Wake a hart waiting for __cpu_up() to hand it a stack */
+void smp_send_wakeup(int cpu);
+
+#ifdef CONFIG_HOTPLUG_CPU
+int __cpu_disable(void);
+void __cpu_die(unsigned int cpu);
+#endif /* CONFIG_HOTPLUG_CPU */
+
 /* Interprocessor interrupt handler */
 irqreturn_t handle_ipi(void);
 
@@ -4,6 +4,7 @@
 #include <asm/processor.h>
 #include <asm/ptrace.h>
 #include <asm/csr.h>
+#include <asm/mmu_context.h>
 
 extern void __fstate_save(struct task_struct *);
 extern void __fstate_restore(struct task_struct *);
@@ -51,6 +52,8 @@ do {							\
 	struct task_struct *__prev = (prev);		\
 	struct task_struct *__next = (next);		\
 	__switch_to_aux(__prev, __next);		\
+	if (__next->mm)					\
+		flush_icache_deferred(__next->mm);	\
 	((last) = __switch_to(__prev, __next));		\
 } while (0)
 
@@ -8,5 +8,6 @@
 /* kernel/sys_riscv.c */
 asmlinkage long sys_sysriscv(unsigned long, unsigned long,
 	unsigned long, unsigned long);
+asmlinkage long sys_riscv_flush_icache(uintptr_t, uintptr_t, uintptr_t);
 
 #endif /* _ASM_RISCV_SYSCALLS_H */
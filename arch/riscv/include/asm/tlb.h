@@ -5,7 +5,13 @@
 
 static inline void tlb_flush(struct mmu_gather *tlb)
 {
-	flush_tlb_mm(tlb->mm);
+	struct vm_area_struct vma = { .vm_mm = tlb->mm, };
+
+	/* Only the range gathered since the last flush needs to go */
+	if (tlb->fullmm)
+		flush_tlb_mm(tlb->mm);
+	else
+		flush_tlb_range(&vma, tlb->start, tlb->end);
 }
 
 #endif /* _ASM_RISCV_TLB_H */
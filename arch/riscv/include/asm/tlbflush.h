@@ -7,6 +7,14 @@
 #include <linux/bug.h>
 #include <asm/csr.h>
 
+/*
+ * The TLB code assumes the most conservative sfence.vm semantics: without
+ * an address it drops every translation of every ASID, while a page fence
+ * only drops that page for the current ASID and for global mappings. Page
+ * fences therefore cannot reach an mm that the hart is not running;
+ * drop_mmu_context() retires its ASID instead.
+ */
+
 /* Flush entire local TLB */
 static inline void local_flush_tlb_all(void)
 {
@@ -19,35 +27,35 @@ static inline void local_flush_tlb_page(unsigned long addr)
 	__asm__ __volatile__ ("sfence.vm %0" : : "r" (addr));
 }
 
-#ifndef CONFIG_SMP
+/* Used by the batched unmap code in mm/rmap.c */
+#define local_flush_tlb() local_flush_tlb_all()
 
-#define flush_tlb_all() local_flush_tlb_all()
-#define flush_tlb_page(vma, addr) local_flush_tlb_page(addr)
-#define flush_tlb_range(vma, start, end) local_flush_tlb_all()
+/* End of a range that covers the whole address space */
+#define TLB_FLUSH_ALL	(-1UL)
 
-#else /* CONFIG_SMP */
+#ifndef CONFIG_SMP
+#define flush_tlb_all() local_flush_tlb_all()
 
+static inline void flush_tlb_others(const struct cpumask *cpumask,
+	struct mm_struct *mm, unsigned long start, unsigned long end)
+{
+}
+#else
 #include <asm/sbi.h>
-
 #define flush_tlb_all() sbi_remote_sfence_vm(0, 0)
-#define flush_tlb_page(vma, addr) flush_tlb_range(vma, (addr), (addr) + 1)
-#define flush_tlb_range(vma, start, end) \
-	sbi_remote_sfence_vm_range(0, 0, (start), (end) - (start))
 
+void flush_tlb_others(const struct cpumask *cpumask, struct mm_struct *mm,
+	unsigned long start, unsigned long end);
 #endif /* CONFIG_SMP */
 
-/* Flush the TLB entries of the specified mm context */
-static inline void flush_tlb_mm(struct mm_struct *mm)
-{
-	flush_tlb_all();
-}
+/* User flushes only go to the harts in mm_cpumask (mm/tlbflush.c) */
+void flush_tlb_mm(struct mm_struct *mm);
+void flush_tlb_page(struct vm_area_struct *vma, unsigned long addr);
+void flush_tlb_range(struct vm_area_struct *vma, unsigned long start,
+	unsigned long end);
 
 /* Flush a range of kernel pages */
-static inline void flush_tlb_kernel_range(unsigned long start,
-	unsigned long end)
-{
-	flush_tlb_all();
-}
+void flush_tlb_kernel_range(unsigned long start, unsigned long end);
 
 #else /* !CONFIG_MMU */
 
@@ -3,7 +3,31 @@
 
 #include <linux/types.h>
 
+/*
+ * Timekeeping data shared with the vDSO. The kernel updates it from
+ * update_vsyscall() under tb_seq_count, which is odd while an update is
+ * in progress; readers retry until they see the same even count twice.
+ */
 struct vdso_data {
+	__u64 cs_cycle_last;	/* rdtime at the last timekeeper update */
+	__u64 raw_time_sec;	/* Raw time */
+	__u64 raw_time_nsec;
+	__u64 xtime_clock_sec;	/* Kernel time */
+	__u64 xtime_clock_nsec;	/* Shifted left by cs_shift */
+	__u64 xtime_coarse_sec;	/* Coarse time */
+	__u64 xtime_coarse_nsec;
+	__u64 wtm_clock_sec;	/* Wall to monotonic time */
+	__u64 wtm_clock_nsec;
+	__u32 tb_seq_count;	/* Timebase sequence counter */
+	__u32 cs_mono_mult;	/* NTP-adjusted clocksource multiplier */
+	__u32 cs_shift;		/* Clocksource shift (mono = raw) */
+	__u32 cs_raw_mult;	/* Raw clocksource multiplier */
+	__s32 tz_minuteswest;	/* Timezone info for gettimeofday */
+	__s32 tz_dsttime;
+	__u32 use_syscall;	/* Clocksource is not rdtime */
+	__u32 hrtimer_res;	/* Resolution of the fine clocks */
+	__u32 coarse_res;	/* Resolution of the coarse clocks */
+	__u32 jiffies;		/* Low word of jiffies, stamps getcpu caches */
 };
 
 #define VDSO_SYMBOL(base, name)					\
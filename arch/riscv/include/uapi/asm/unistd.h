@@ -5,5 +5,12 @@
 __SYSCALL(__NR_sysriscv, sys_sysriscv)
 #endif
 
+#define __NR_riscv_flush_icache  (__NR_arch_specific_syscall + 15)
+__SYSCALL(__NR_riscv_flush_icache, sys_riscv_flush_icache)
+
+/* Flags for riscv_flush_icache */
+#define SYS_RISCV_FLUSH_ICACHE_LOCAL  1UL
+#define SYS_RISCV_FLUSH_ICACHE_ALL    (SYS_RISCV_FLUSH_ICACHE_LOCAL)
+
 #define RISCV_ATOMIC_CMPXCHG    1
 #define RISCV_ATOMIC_CMPXCHG64  2
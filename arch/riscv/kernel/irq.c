@@ -1,20 +1,14 @@
 #include <linux/interrupt.h>
 #include <linux/ftrace.h>
 #include <linux/seq_file.h>
+#include <linux/irq.h>
+#include <linux/ratelimit.h>
 
 #include <asm/ptrace.h>
 #include <asm/sbi.h>
 #include <asm/sbi-con.h>
 #include <asm/smp.h>
 
-struct plic_context {
-	volatile int priority_threshold;
-	volatile int claim;
-};
-
-static DEFINE_PER_CPU(struct plic_context *, plic_context);
-static DEFINE_PER_CPU(unsigned int, irq_in_progress);
-
 static void riscv_software_interrupt(void)
 {
 	irqreturn_t ret;
@@ -29,6 +23,9 @@ static void riscv_software_interrupt(void)
 }
 
 extern void plic_interrupt(void);
+#ifdef CONFIG_PLIC_LATENCY_STATS
+DECLARE_PER_CPU(cycles_t, plic_trap_entry);
+#endif
 
 asmlinkage void __irq_entry do_IRQ(unsigned int cause, struct pt_regs *regs)
 {
@@ -46,6 +43,9 @@ asmlinkage void __irq_entry do_IRQ(unsigned int cause, struct pt_regs *regs)
 			riscv_software_interrupt();
 			break;
 		case INTERRUPT_CAUSE_EXTERNAL:
+#ifdef CONFIG_PLIC_LATENCY_STATS
+			__this_cpu_write(plic_trap_entry, get_cycles());
+#endif
 			plic_interrupt();
 			break;
 		default:
@@ -56,32 +56,63 @@ asmlinkage void __irq_entry do_IRQ(unsigned int cause, struct pt_regs *regs)
 	set_irq_regs(old_regs);
 }
 
-static void plic_irq_mask(struct irq_data *d)
+void __init init_IRQ(void)
 {
-	unsigned int cpu = smp_processor_id();
-
-	BUG_ON(d->irq != per_cpu(irq_in_progress, cpu));
+	/* Enable software interrupts (and disable the others) */
+	csr_write(sie, SIE_SSIE);
 }
 
-static void plic_irq_unmask(struct irq_data *d)
+#ifdef CONFIG_HOTPLUG_CPU
+static bool migrate_one_irq(struct irq_desc *desc)
 {
-	unsigned int cpu = smp_processor_id();
+	struct irq_data *d = irq_desc_get_irq_data(desc);
+	const struct cpumask *affinity = irq_data_get_affinity_mask(d);
+	struct irq_chip *c;
+	bool ret = false;
+
+	if (irqd_is_per_cpu(d) ||
+	    !cpumask_test_cpu(smp_processor_id(), affinity))
+		return false;
+
+	/* No online hart left in the mask: fall back to any of them */
+	if (cpumask_any_and(affinity, cpu_online_mask) >= nr_cpu_ids) {
+		affinity = cpu_online_mask;
+		ret = true;
+	}
 
-	BUG_ON(d->irq != per_cpu(irq_in_progress, cpu));
+	c = irq_data_get_irq_chip(d);
+	if (!c->irq_set_affinity)
+		pr_debug("IRQ%u: unable to set affinity\n", d->irq);
+	else if (c->irq_set_affinity(d, affinity, false) == IRQ_SET_MASK_OK && ret)
+		cpumask_copy(irq_data_get_affinity_mask(d), affinity);
 
-	per_cpu(plic_context, cpu)->claim = per_cpu(irq_in_progress, cpu);
-	per_cpu(irq_in_progress, cpu) = 0;
+	return ret;
 }
 
-struct irq_chip plic_irq_chip = {
-	.name = "riscv",
-	.irq_mask = plic_irq_mask,
-	.irq_mask_ack = plic_irq_mask,
-	.irq_unmask = plic_irq_unmask,
-};
-
-void __init init_IRQ(void)
+/*
+ * Called from __cpu_disable() with this hart already cleared from
+ * cpu_online_mask, so the irqchip picks one of the remaining harts.
+ */
+void migrate_irqs(void)
 {
-	/* Enable software interrupts (and disable the others) */
-	csr_write(sie, SIE_SSIE);
+	struct irq_desc *desc;
+	unsigned long flags;
+	unsigned int i;
+
+	local_irq_save(flags);
+
+	for_each_irq_desc(i, desc) {
+		bool affinity_broken;
+
+		raw_spin_lock(&desc->lock);
+		affinity_broken = migrate_one_irq(desc);
+		raw_spin_unlock(&desc->lock);
+
+		if (affinity_broken)
+			pr_warn_ratelimited("IRQ%u no longer affine to CPU%u\n",
+					    i, smp_processor_id());
+	}
+
+	local_irq_restore(flags);
 }
+#endif /* CONFIG_HOTPLUG_CPU */
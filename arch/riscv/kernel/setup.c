@@ -129,6 +129,7 @@ void __init setup_arch(char **cmdline_p)
 	strlcpy(command_line, boot_command_line, COMMAND_LINE_SIZE);
 	*cmdline_p = command_line;
 
+	riscv_sched_clock_init();
 	parse_early_param();
 
 	init_mm.start_code = (unsigned long) _stext;
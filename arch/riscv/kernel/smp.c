@@ -1,6 +1,7 @@
 #include <linux/interrupt.h>
 #include <linux/smp.h>
 #include <linux/sched.h>
+#include <linux/irq_work.h>
 
 #include <asm/sbi.h>
 #include <asm/tlbflush.h>
@@ -14,6 +15,7 @@ static struct {
 enum ipi_message_type {
 	IPI_RESCHEDULE,
 	IPI_CALL_FUNC,
+	IPI_IRQ_WORK,
 	IPI_MAX
 };
 
@@ -36,6 +38,9 @@ irqreturn_t handle_ipi(void)
 		if (ops & (1 << IPI_CALL_FUNC))
 			generic_smp_call_function_interrupt();
 
+		if (ops & (1 << IPI_IRQ_WORK))
+			irq_work_run();
+
 		BUG_ON((ops >> IPI_MAX) != 0);
 
 		mb();	/* Order data access and bit testing. */
@@ -44,17 +49,38 @@ irqreturn_t handle_ipi(void)
 	return IRQ_HANDLED;
 }
 
+/*
+ * Every sbi_send_ipi() is a trap into machine mode, so only harts whose
+ * message word goes from zero to non-zero get one. A non-zero word means an
+ * IPI is already on its way and handle_ipi() has yet to drain the word, at
+ * which point it picks up the new message as well.
+ */
 static void
 send_ipi_message(const struct cpumask *to_whom, enum ipi_message_type operation)
 {
+	struct cpumask targets;
+	unsigned long old;
 	int i;
 
+	/*
+	 * Order the caller's payload before the message bit. cmpxchg() is
+	 * not ordered here, and when the IPI is skipped the receiver only
+	 * has the bit to go by.
+	 */
 	mb();
-	for_each_cpu(i, to_whom)
-		set_bit(operation, &ipi_data[i].bits);
+
+	cpumask_clear(&targets);
+	for_each_cpu(i, to_whom) {
+		do {
+			old = READ_ONCE(ipi_data[i].bits);
+		} while (cmpxchg(&ipi_data[i].bits, old,
+				 old | (1 << operation)) != old);
+		if (!old)
+			cpumask_set_cpu(i, &targets);
+	}
 
 	mb();
-	for_each_cpu(i, to_whom)
+	for_each_cpu(i, &targets)
 		sbi_send_ipi(i);
 }
 
@@ -68,8 +94,28 @@ void arch_send_call_function_single_ipi(int cpu)
 	send_ipi_message(cpumask_of(cpu), IPI_CALL_FUNC);
 }
 
+/*
+ * Messages queued for a hart before it went offline are stale. Drop them,
+ * or the non-zero word would keep send_ipi_message() from ever sending
+ * the hart another IPI.
+ */
+void smp_send_wakeup(int cpu)
+{
+	WRITE_ONCE(ipi_data[cpu].bits, 0);
+	mb();
+	sbi_send_ipi(cpu);
+}
+
+/* Run queued irq_work from interrupt context instead of the next tick */
+void arch_irq_work_raise(void)
+{
+	send_ipi_message(cpumask_of(smp_processor_id()), IPI_IRQ_WORK);
+}
+
 static void ipi_stop(void *unused)
 {
+	set_cpu_online(smp_processor_id(), false);
+	local_irq_disable();
 	while (1)
 		wait_for_interrupt();
 }
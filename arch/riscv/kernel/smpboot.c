@@ -10,19 +10,29 @@
 #include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/irq.h>
+#include <linux/completion.h>
 #include <asm/mmu_context.h>
 #include <asm/tlbflush.h>
 #include <asm/sections.h>
 #include <asm/sbi.h>
+#include <asm/irq.h>
 
 void *__cpu_up_stack_pointer[NR_CPUS];
 
+/* Signalled by smp_callin() once the hart is online */
+static DECLARE_COMPLETION(cpu_running);
+
+static u64 __initdata smp_boot_start;
+
+asmlinkage void __noreturn __cpu_up_wait(unsigned long hartid);
+
 void __init smp_prepare_boot_cpu(void)
 {
 }
 
 void __init smp_prepare_cpus(unsigned int max_cpus)
 {
+	smp_boot_start = local_clock();
 }
 
 void __init setup_smp(void)
@@ -35,37 +45,118 @@ void __init setup_smp(void)
 	}
 }
 
+/*
+ * The hart waits in wfi for its stack; instead of spinning on cpu_online
+ * until it gets there, sleep until smp_callin() reports back.
+ */
 int __cpu_up(unsigned int cpu, struct task_struct *tidle)
 {
-	/* Signal cpu to start */
-	__cpu_up_stack_pointer[cpu] = task_stack_page(tidle) + THREAD_SIZE;
+	void *sp = task_stack_page(tidle) + THREAD_SIZE;
+	u64 start = local_clock();
+
+	/* Start every bring-up with a fresh completion */
+	reinit_completion(&cpu_running);
+
+	/* The idle thread must be visible before the hart can find it */
+	smp_wmb();
+	WRITE_ONCE(__cpu_up_stack_pointer[cpu], sp);
+	smp_send_wakeup(cpu);
+
+	if (!wait_for_completion_timeout(&cpu_running,
+					 msecs_to_jiffies(5000))) {
+		/*
+		 * smp_callin() takes the stack out of the slot before anything
+		 * else. If it is still there, the hart will find it gone and
+		 * park again; otherwise the hart is already on its way up.
+		 */
+		if (cmpxchg(&__cpu_up_stack_pointer[cpu], sp, NULL) == sp) {
+			pr_crit("CPU%u: failed to come online\n", cpu);
+			return -EIO;
+		}
+		wait_for_completion(&cpu_running);
+	}
 
-	while (!cpu_online(cpu))
-		;
-	
+	pr_info("CPU%u: online in %llu us\n", cpu,
+		div_u64(local_clock() - start, NSEC_PER_USEC));
 	return 0;
 }
 
 void __init smp_cpus_done(unsigned int max_cpus)
 {
+	pr_info("SMP: %u harts online in %llu us\n", num_online_cpus(),
+		div_u64(local_clock() - smp_boot_start, NSEC_PER_USEC));
+}
+
+#ifdef CONFIG_HOTPLUG_CPU
+int __cpu_disable(void)
+{
+	unsigned int cpu = smp_processor_id();
+
+	set_cpu_online(cpu, false);
+	migrate_irqs();
+
+	/* The generic code hands the tick over; stop this hart's timer */
+	csr_clear(sie, SIE_STIE);
+
+	clear_tasks_mm_cpumask(cpu);
+	return 0;
+}
+
+void __cpu_die(unsigned int cpu)
+{
+	if (!cpu_wait_death(cpu, 5)) {
+		pr_err("CPU%u: did not go offline\n", cpu);
+		return;
+	}
+	pr_notice("CPU%u: offline\n", cpu);
 }
 
+/*
+ * Called from the idle loop of a hart that has gone offline. The hart
+ * waits in wfi with only software interrupts enabled until __cpu_up()
+ * hands it a new stack, then starts over through smp_callin().
+ */
+void arch_cpu_idle_dead(void)
+{
+	unsigned int cpu = smp_processor_id();
+
+	idle_task_exit();
+
+	csr_write(sie, SIE_SSIE);
+	sbi_clear_ipi();
+	WRITE_ONCE(__cpu_up_stack_pointer[cpu], NULL);
+	smp_mb();
+	(void)cpu_report_death();
+
+	__cpu_up_wait(cpu);
+}
+#endif /* CONFIG_HOTPLUG_CPU */
+
 /*
  * C entry point for a secondary processor.
  */
-asmlinkage void __init smp_callin(void)
+asmlinkage void smp_callin(void)
 {
 	struct mm_struct *mm = &init_mm;
+	unsigned int cpu = smp_processor_id();
+	void *sp = task_stack_page(current) + THREAD_SIZE;
+
+	/* __cpu_up() gave up on this hart if the stack is gone: park again */
+	if (cmpxchg(&__cpu_up_stack_pointer[cpu], sp, NULL) != sp)
+		__cpu_up_wait(cpu);
 
 	/* All kernel threads share the same mm context.  */
 	atomic_inc(&mm->mm_count);
 	current->active_mm = mm;
 
 	trap_init();
-	init_clockevent();
-	notify_cpu_starting(smp_processor_id());
-	set_cpu_online(smp_processor_id(), 1);
 	local_flush_tlb_all();
+	/* Kernel text may have changed while the hart was offline */
+	local_flush_icache_all();
+	init_clockevent();
+	notify_cpu_starting(cpu);
+	set_cpu_online(cpu, 1);
+	complete(&cpu_running);
 	local_irq_enable();
 	preempt_disable();
 	cpu_startup_entry(CPUHP_ONLINE);
@@ -1,5 +1,6 @@
 #include <linux/syscalls.h>
 #include <asm/unistd.h>
+#include <asm/cacheflush.h>
 
 SYSCALL_DEFINE6(mmap, unsigned long, addr, unsigned long, len,
 	unsigned long, prot, unsigned long, flags,
@@ -68,3 +69,19 @@ SYSCALL_DEFINE4(sysriscv, unsigned long, cmd, unsigned long, arg1,
 	return -EINVAL;
 }
 #endif /* CONFIG_RV_SYSRISCV_ATOMIC */
+
+/*
+ * Make instruction fetches see code this process wrote, for JITs and the
+ * like. The range is accepted for future use; the whole icache is flushed.
+ * SYS_RISCV_FLUSH_ICACHE_LOCAL restricts the immediate flush to this hart;
+ * other harts still flush before they next run the process.
+ */
+SYSCALL_DEFINE3(riscv_flush_icache, uintptr_t, start, uintptr_t, end,
+	uintptr_t, flags)
+{
+	if (unlikely(flags & ~SYS_RISCV_FLUSH_ICACHE_ALL))
+		return -EINVAL;
+
+	flush_icache_mm(current->mm, flags & SYS_RISCV_FLUSH_ICACHE_LOCAL);
+	return 0;
+}
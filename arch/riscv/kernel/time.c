@@ -3,20 +3,54 @@
 #include <linux/interrupt.h>
 #include <linux/irq.h>
 #include <linux/delay.h>
+#include <linux/sched.h>
+#include <linux/sched_clock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/stringify.h>
+#include <linux/string.h>
 
 #include <asm/irq.h>
 #include <asm/csr.h>
 #include <asm/sbi.h>
 #include <asm/delay.h>
+#include <asm/config-string.h>
 
 unsigned long timebase;
 
 static DEFINE_PER_CPU(struct clock_event_device, clock_event);
 
+/*
+ * Programming the timer is an SBI call, i.e. a trap into machine mode. It is
+ * skipped when the deadline already armed on this hart is no earlier than
+ * the requested one and at most timer_coalesce ticks later; the event then
+ * fires that little bit late instead. timer_armed is 0 when nothing is armed.
+ */
+static u32 timer_coalesce;
+static DEFINE_PER_CPU(u64, timer_armed);
+static DEFINE_PER_CPU(unsigned long, timer_programmed);
+static DEFINE_PER_CPU(unsigned long, timer_skipped);
+
+/*
+ * The SBI timer cannot be cancelled and stays pending once it fires, so the
+ * interrupt is masked while no event is armed. This is what lets a hart with
+ * its tick stopped (idle, or nohz_full) sleep without any timer traps.
+ */
 static int riscv_timer_set_next_event(unsigned long delta,
 	struct clock_event_device *evdev)
 {
-	sbi_set_timer(get_cycles() + delta);
+	u64 next = get_cycles() + delta;
+	u64 armed = __this_cpu_read(timer_armed);
+
+	if (armed && armed >= next && armed - next <= READ_ONCE(timer_coalesce)) {
+		__this_cpu_inc(timer_skipped);
+		return 0;
+	}
+
+	__this_cpu_write(timer_armed, next);
+	__this_cpu_inc(timer_programmed);
+	sbi_set_timer(next);
+	csr_set(sie, SIE_STIE);
 	return 0;
 }
 
@@ -28,10 +62,78 @@ static int riscv_timer_set_oneshot(struct clock_event_device *evt)
 
 static int riscv_timer_set_shutdown(struct clock_event_device *evt)
 {
-	/* can't stop the clock! */
+	csr_clear(sie, SIE_STIE);
+	__this_cpu_write(timer_armed, 0);
 	return 0;
 }
 
+/*
+ * With the Sstc extension the hart compares time against stimecmp itself,
+ * so the kernel programs the timer with a CSR write instead of an SBI call.
+ * Writing a deadline in the future also clears the pending interrupt.
+ */
+static void riscv_stimecmp_write(u64 value)
+{
+#ifdef CONFIG_64BIT
+	__asm__ __volatile__ ("csrw " __stringify(CSR_STIMECMP) ", %0" : : "r" (value));
+#else
+	/* Park the low half at its maximum so no bogus match is possible */
+	__asm__ __volatile__ (
+		"csrw " __stringify(CSR_STIMECMP) ", %0\n"
+		"csrw " __stringify(CSR_STIMECMPH) ", %1\n"
+		"csrw " __stringify(CSR_STIMECMP) ", %2"
+		: : "r" (-1UL), "r" ((u32)(value >> 32)), "r" ((u32)value));
+#endif
+}
+
+static int riscv_timer_set_next_event_sstc(unsigned long delta,
+	struct clock_event_device *evdev)
+{
+	riscv_stimecmp_write(get_cycles() + delta);
+	csr_set(sie, SIE_STIE);
+	return 0;
+}
+
+static int riscv_timer_set_shutdown_sstc(struct clock_event_device *evt)
+{
+	csr_clear(sie, SIE_STIE);
+	riscv_stimecmp_write(ULLONG_MAX);
+	return 0;
+}
+
+/*
+ * Harts that list Sstc in their ISA string in the config string, e.g.
+ * "core { 0 { 0 { isa rv64imafdc_sstc; ...". Filled in by time_init()
+ * before any hart sets up its clock_event_device.
+ */
+static struct cpumask riscv_sstc_harts __read_mostly;
+
+/* Multi-letter extensions follow the single-letter ones, each after a '_' */
+static bool __init riscv_isa_has_ext(const char *isa, const char *ext)
+{
+	size_t len = strlen(ext);
+
+	while ((isa = strchr(isa, '_')) != NULL) {
+		++isa;
+		if (!strncasecmp(isa, ext, len) && (isa[len] == '_' || !isa[len]))
+			return true;
+	}
+	return false;
+}
+
+static void __init riscv_sstc_detect(void)
+{
+	char key[32], isa[128];
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		snprintf(key, sizeof(key), "core.%d.0.isa", cpu);
+		if (config_string_early_str(key, isa, sizeof(isa)) &&
+		    riscv_isa_has_ext(isa, "sstc"))
+			cpumask_set_cpu(cpu, &riscv_sstc_harts);
+	}
+}
+
 static cycle_t riscv_rdtime(struct clocksource *cs)
 {
 	return get_cycles();
@@ -43,20 +145,48 @@ static struct clocksource riscv_clocksource = {
 	.read = riscv_rdtime,
 	.mask = CLOCKSOURCE_MASK(64),
 	.flags = CLOCK_SOURCE_IS_CONTINUOUS,
+	.archdata = { .vdso_direct = true },
 };
 
+/*
+ * rdtime is constant-rate and readable from any mode, so it doubles as
+ * sched_clock. That lets IRQ time accounting charge hardirq and softirq
+ * time precisely instead of billing it to the interrupted task.
+ */
+static u64 notrace riscv_sched_clock(void)
+{
+	return get_cycles();
+}
+
+/*
+ * The timebase comes from the SBI, which is usable from the first
+ * instruction, so setup_arch() registers sched_clock right away. printk
+ * timestamps are then fine-grained from that point on.
+ */
+void __init riscv_sched_clock_init(void)
+{
+	timebase = sbi_timebase();
+	sched_clock_register(riscv_sched_clock, 64, timebase);
+}
+
 void riscv_timer_interrupt(void)
 {
 	int cpu = smp_processor_id();
 	struct clock_event_device *evdev = &per_cpu(clock_event, cpu);
+
+	csr_clear(sie, SIE_STIE);
+	__this_cpu_write(timer_armed, 0);
 	evdev->event_handler(evdev);
 }
 
-void __init init_clockevent(void)
+void init_clockevent(void)
 {
 	int cpu = smp_processor_id();
 	struct clock_event_device *ce = &per_cpu(clock_event, cpu);
 
+	/* A hart coming back online must not skip its first programming */
+	__this_cpu_write(timer_armed, 0);
+
 	*ce = (struct clock_event_device){
 		.name = "riscv_timer_clockevent",
 		.features = CLOCK_EVT_FEAT_ONESHOT,
@@ -65,22 +195,75 @@ void __init init_clockevent(void)
 		.set_next_event = riscv_timer_set_next_event,
 		.set_state_oneshot  = riscv_timer_set_oneshot,
 		.set_state_shutdown = riscv_timer_set_shutdown,
+		.set_state_oneshot_stopped = riscv_timer_set_shutdown,
 	};
 
+	/* Each hart decides for itself; the SBI timer is the fallback */
+	if (cpumask_test_cpu(cpu, &riscv_sstc_harts)) {
+		ce->set_next_event = riscv_timer_set_next_event_sstc;
+		ce->set_state_shutdown = riscv_timer_set_shutdown_sstc;
+		ce->set_state_oneshot_stopped = riscv_timer_set_shutdown_sstc;
+		pr_info("riscv_timer: hart %d uses Sstc stimecmp\n", cpu);
+	}
+
 	clockevents_config_and_register(ce, sbi_timebase(), 100, 0x7fffffff);
 }
 
 void __init time_init(void)
 {
 	unsigned long long tb;
-	timebase = sbi_timebase();
+
+	/* timebase was read by riscv_sched_clock_init() */
 	tb = timebase;
 	do_div(tb, HZ);
 	lpj_fine = tb;
 
+	/* Let programming requests up to about 1us apart share one SBI call */
+	timer_coalesce = timebase / USEC_PER_SEC;
+
 	clocksource_register_hz(&riscv_clocksource, timebase);
+	enable_sched_clock_irqtime();
+	riscv_sstc_detect();
 	init_clockevent();
+}
 
-	/* Enable timer interrupts. */
-	csr_set(sie, SIE_STIE);
+#ifdef CONFIG_DEBUG_FS
+static int riscv_timer_stats_show(struct seq_file *m, void *v)
+{
+	int cpu;
+
+	seq_printf(m, "cpu   programmed      skipped\n");
+	for_each_online_cpu(cpu)
+		seq_printf(m, "%3d %12lu %12lu\n", cpu,
+			   per_cpu(timer_programmed, cpu),
+			   per_cpu(timer_skipped, cpu));
+
+	return 0;
+}
+
+static int riscv_timer_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, riscv_timer_stats_show, NULL);
+}
+
+static const struct file_operations riscv_timer_stats_fops = {
+	.open		= riscv_timer_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init riscv_timer_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("timer", arch_debugfs_dir);
+	if (IS_ERR_OR_NULL(dir))
+		return 0;
+
+	debugfs_create_u32("coalesce_ticks", S_IRUGO | S_IWUSR, dir, &timer_coalesce);
+	debugfs_create_file("stats", S_IRUGO, dir, NULL, &riscv_timer_stats_fops);
+	return 0;
 }
+late_initcall(riscv_timer_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
@@ -136,7 +136,7 @@ int is_valid_bugaddr(unsigned long pc)
 }
 #endif /* CONFIG_GENERIC_BUG */
 
-void __init trap_init(void)
+void trap_init(void)
 {
 	/* Set sup0 scratch register to 0, indicating to exception vector
 	   that we are presently executing in the kernel */
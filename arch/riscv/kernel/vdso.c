@@ -2,6 +2,8 @@
 #include <linux/slab.h>
 #include <linux/binfmts.h>
 #include <linux/err.h>
+#include <linux/hrtimer.h>
+#include <linux/timekeeper_internal.h>
 
 #include <asm/vdso.h>
 
@@ -10,6 +12,15 @@ extern char vdso_start[], vdso_end[];
 static unsigned int vdso_pages;
 static struct page **vdso_pagelist;
 
+/*
+ * The data page is mapped read-only right below the vDSO text, which
+ * finds it at the fixed offset _vdso_data (see vdso.lds.S).
+ */
+static struct vm_special_mapping vdso_spec[2] = {
+	{ .name = "[vvar]" },
+	{ .name = "[vdso]" },
+};
+
 /*
  * The vDSO data page.
  */
@@ -30,13 +41,19 @@ static int __init vdso_init(void)
 		return -ENOMEM;
 	}
 
+	vdso_pagelist[0] = virt_to_page(vdso_data);
 	for (i = 0; i < vdso_pages; i++) {
 		struct page *pg;
 		pg = virt_to_page(vdso_start + (i << PAGE_SHIFT));
 		ClearPageReserved(pg);
-		vdso_pagelist[i] = pg;
+		vdso_pagelist[i + 1] = pg;
 	}
-	vdso_pagelist[i] = virt_to_page(vdso_data);
+
+	vdso_spec[0].pages = &vdso_pagelist[0];
+	vdso_spec[1].pages = &vdso_pagelist[1];
+
+	vdso_data->coarse_res = LOW_RES_NSEC;
+	vdso_data->hrtimer_res = hrtimer_resolution;
 
 	return 0;
 }
@@ -46,8 +63,9 @@ int arch_setup_additional_pages(struct linux_binprm *bprm,
 	int uses_interp)
 {
 	struct mm_struct *mm = current->mm;
+	struct vm_area_struct *vma;
 	unsigned long vdso_base, vdso_len;
-	int ret;
+	int ret = 0;
 
 	vdso_len = (vdso_pages + 1) << PAGE_SHIFT;
 
@@ -58,18 +76,26 @@ int arch_setup_additional_pages(struct linux_binprm *bprm,
 		goto end;
 	}
 
+	vma = _install_special_mapping(mm, vdso_base, PAGE_SIZE,
+		(VM_READ | VM_MAYREAD), &vdso_spec[0]);
+	if (unlikely(IS_ERR(vma))) {
+		ret = PTR_ERR(vma);
+		goto end;
+	}
+
 	/*
 	 * Put vDSO base into mm struct. We need to do this before calling
 	 * install_special_mapping or the perf counter mmap tracking code
 	 * will fail to recognise it as a vDSO (since arch_vma_name fails).
 	 */
+	vdso_base += PAGE_SIZE;
 	mm->context.vdso = (void *)vdso_base;
 
-	ret = install_special_mapping(mm, vdso_base, vdso_len,
+	vma = _install_special_mapping(mm, vdso_base, vdso_len - PAGE_SIZE,
 		(VM_READ | VM_EXEC | VM_MAYREAD | VM_MAYWRITE | VM_MAYEXEC),
-		vdso_pagelist);
-
-	if (unlikely(ret)) {
+		&vdso_spec[1]);
+	if (unlikely(IS_ERR(vma))) {
+		ret = PTR_ERR(vma);
 		mm->context.vdso = NULL;
 	}
 
@@ -78,6 +104,45 @@ end:
 	return ret;
 }
 
+void update_vsyscall(struct timekeeper *tk)
+{
+	u32 use_syscall = !tk->tkr_mono.clock->archdata.vdso_direct;
+
+	++vdso_data->tb_seq_count;
+	smp_wmb();
+
+	vdso_data->use_syscall			= use_syscall;
+	vdso_data->xtime_coarse_sec		= tk->xtime_sec;
+	vdso_data->xtime_coarse_nsec		= tk->tkr_mono.xtime_nsec >>
+							tk->tkr_mono.shift;
+	vdso_data->wtm_clock_sec		= tk->wall_to_monotonic.tv_sec;
+	vdso_data->wtm_clock_nsec		= tk->wall_to_monotonic.tv_nsec;
+	vdso_data->hrtimer_res			= hrtimer_resolution;
+	vdso_data->jiffies			= (u32)jiffies;
+
+	if (!use_syscall) {
+		/* tkr_mono.cycle_last == tkr_raw.cycle_last */
+		vdso_data->cs_cycle_last	= tk->tkr_mono.cycle_last;
+		vdso_data->raw_time_sec		= tk->raw_time.tv_sec;
+		vdso_data->raw_time_nsec	= tk->raw_time.tv_nsec;
+		vdso_data->xtime_clock_sec	= tk->xtime_sec;
+		vdso_data->xtime_clock_nsec	= tk->tkr_mono.xtime_nsec;
+		vdso_data->cs_mono_mult		= tk->tkr_mono.mult;
+		vdso_data->cs_raw_mult		= tk->tkr_raw.mult;
+		/* tkr_mono.shift == tkr_raw.shift */
+		vdso_data->cs_shift		= tk->tkr_mono.shift;
+	}
+
+	smp_wmb();
+	++vdso_data->tb_seq_count;
+}
+
+void update_vsyscall_tz(void)
+{
+	vdso_data->tz_minuteswest	= sys_tz.tz_minuteswest;
+	vdso_data->tz_dsttime		= sys_tz.tz_dsttime;
+}
+
 const char *arch_vma_name(struct vm_area_struct *vma)
 {
 	if (vma->vm_mm && (vma->vm_start == (long)vma->vm_mm->context.vdso)) {
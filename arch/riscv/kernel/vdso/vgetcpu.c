@@ -0,0 +1,50 @@
+/*
+ * User-space getcpu for the vDSO.
+ *
+ * There is no register user mode can read the hart id from, so the answer
+ * comes from the getcpu system call. A caller that passes a tcache gets
+ * the getcpu(2) cache semantics: the result is stored in the cache along
+ * with the jiffies count from the data page, and is returned from there
+ * without a trap until the next tick. A thread may have moved since, which
+ * getcpu allows for anyway.
+ */
+
+#include <linux/compiler.h>
+#include <linux/getcpu.h>
+#include <asm/unistd.h>
+#include <asm/vdso.h>
+
+extern const struct vdso_data _vdso_data __attribute__((visibility("hidden")));
+
+notrace int __vdso_getcpu(unsigned *cpu, unsigned *node, struct getcpu_cache *tcache)
+{
+	unsigned long j = READ_ONCE(_vdso_data.jiffies);
+	unsigned int c, n;
+
+	if (tcache && tcache->blob[0] == j) {
+		c = tcache->blob[1];
+		n = tcache->blob[2];
+	} else {
+		register long a0 asm("a0") = (long)&c;
+		register long a1 asm("a1") = (long)&n;
+		register long a2 asm("a2") = 0;
+		register long a7 asm("a7") = __NR_getcpu;
+
+		asm volatile ("scall" : "+r" (a0) : "r" (a1), "r" (a2), "r" (a7) : "memory");
+		if (a0)
+			return a0;
+
+		if (tcache) {
+			tcache->blob[1] = c;
+			tcache->blob[2] = n;
+			tcache->blob[0] = j;
+		}
+	}
+
+	if (cpu)
+		*cpu = c;
+	if (node)
+		*node = n;
+
+	return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * User-space clock_gettime, gettimeofday and clock_getres for the vDSO.
+ *
+ * Time is computed from rdtime and the data page that update_vsyscall()
+ * keeps current. Clocks the data page cannot serve, and any clocksource
+ * other than rdtime, fall back to the real system call.
+ */
+
+#include <linux/compiler.h>
+#include <linux/time.h>
+#include <asm/barrier.h>
+#include <asm/timex.h>
+#include <asm/unistd.h>
+#include <asm/vdso.h>
+
+extern const struct vdso_data _vdso_data __attribute__((visibility("hidden")));
+
+static notrace long vdso_fallback(long nr, long arg0, long arg1)
+{
+	register long a0 asm("a0") = arg0;
+	register long a1 asm("a1") = arg1;
+	register long a7 asm("a7") = nr;
+
+	asm volatile ("scall" : "+r" (a0) : "r" (a1), "r" (a7) : "memory");
+	return a0;
+}
+
+static notrace u32 vdso_read_begin(const struct vdso_data *vd)
+{
+	u32 seq;
+
+	while ((seq = READ_ONCE(vd->tb_seq_count)) & 1)
+		barrier();
+	smp_rmb();
+	return seq;
+}
+
+static notrace int vdso_read_retry(const struct vdso_data *vd, u32 start)
+{
+	smp_rmb();
+	return READ_ONCE(vd->tb_seq_count) != start;
+}
+
+static notrace void vdso_set_ts(struct timespec *ts, u64 sec, u64 nsec)
+{
+	/* Avoid a 64-bit division; nsec is at most a few seconds */
+	while (nsec >= NSEC_PER_SEC) {
+		nsec -= NSEC_PER_SEC;
+		++sec;
+	}
+	ts->tv_sec = sec;
+	ts->tv_nsec = nsec;
+}
+
+static notrace int do_realtime_coarse(const struct vdso_data *vd, struct timespec *ts)
+{
+	u64 sec, nsec;
+	u32 seq;
+
+	do {
+		seq = vdso_read_begin(vd);
+		sec = vd->xtime_coarse_sec;
+		nsec = vd->xtime_coarse_nsec;
+	} while (vdso_read_retry(vd, seq));
+
+	vdso_set_ts(ts, sec, nsec);
+	return 0;
+}
+
+static notrace int do_monotonic_coarse(const struct vdso_data *vd, struct timespec *ts)
+{
+	u64 sec, nsec;
+	u32 seq;
+
+	do {
+		seq = vdso_read_begin(vd);
+		sec = vd->xtime_coarse_sec + vd->wtm_clock_sec;
+		nsec = vd->xtime_coarse_nsec + vd->wtm_clock_nsec;
+	} while (vdso_read_retry(vd, seq));
+
+	vdso_set_ts(ts, sec, nsec);
+	return 0;
+}
+
+static notrace int do_hres(const struct vdso_data *vd, clockid_t clock, struct timespec *ts)
+{
+	u64 sec, nsec, delta;
+	u32 seq;
+
+	do {
+		seq = vdso_read_begin(vd);
+		if (vd->use_syscall)
+			return -1;
+
+		delta = get_cycles() - vd->cs_cycle_last;
+		if (clock == CLOCK_MONOTONIC_RAW) {
+			sec = vd->raw_time_sec;
+			nsec = vd->raw_time_nsec +
+				((delta * vd->cs_raw_mult) >> vd->cs_shift);
+		} else {
+			sec = vd->xtime_clock_sec;
+			nsec = (vd->xtime_clock_nsec +
+				delta * vd->cs_mono_mult) >> vd->cs_shift;
+			if (clock == CLOCK_MONOTONIC) {
+				sec += vd->wtm_clock_sec;
+				nsec += vd->wtm_clock_nsec;
+			}
+		}
+	} while (vdso_read_retry(vd, seq));
+
+	vdso_set_ts(ts, sec, nsec);
+	return 0;
+}
+
+notrace int __vdso_clock_gettime(clockid_t clock, struct timespec *ts)
+{
+	const struct vdso_data *vd = &_vdso_data;
+
+	switch (clock) {
+	case CLOCK_REALTIME_COARSE:
+		return do_realtime_coarse(vd, ts);
+	case CLOCK_MONOTONIC_COARSE:
+		return do_monotonic_coarse(vd, ts);
+	case CLOCK_REALTIME:
+	case CLOCK_MONOTONIC:
+	case CLOCK_MONOTONIC_RAW:
+		if (do_hres(vd, clock, ts) == 0)
+			return 0;
+		break;
+	}
+
+	return vdso_fallback(__NR_clock_gettime, clock, (long)ts);
+}
+
+notrace int __vdso_gettimeofday(struct timeval *tv, struct timezone *tz)
+{
+	const struct vdso_data *vd = &_vdso_data;
+	struct timespec ts;
+
+	if (tv) {
+		if (do_hres(vd, CLOCK_REALTIME, &ts))
+			return vdso_fallback(__NR_gettimeofday, (long)tv, (long)tz);
+		tv->tv_sec = ts.tv_sec;
+		tv->tv_usec = ts.tv_nsec / NSEC_PER_USEC;
+	}
+
+	if (tz) {
+		tz->tz_minuteswest = vd->tz_minuteswest;
+		tz->tz_dsttime = vd->tz_dsttime;
+	}
+
+	return 0;
+}
+
+notrace int __vdso_clock_getres(clockid_t clock, struct timespec *res)
+{
+	const struct vdso_data *vd = &_vdso_data;
+	long nsec;
+
+	switch (clock) {
+	case CLOCK_REALTIME:
+	case CLOCK_MONOTONIC:
+	case CLOCK_MONOTONIC_RAW:
+		nsec = READ_ONCE(vd->hrtimer_res);
+		break;
+	case CLOCK_REALTIME_COARSE:
+	case CLOCK_MONOTONIC_COARSE:
+		nsec = vd->coarse_res;
+		break;
+	default:
+		return vdso_fallback(__NR_clock_getres, clock, (long)res);
+	}
+
+	if (res) {
+		res->tv_sec = 0;
+		res->tv_nsec = nsec;
+	}
+
+	return 0;
+}
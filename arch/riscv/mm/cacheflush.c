@@ -0,0 +1,50 @@
+#include <linux/mm.h>
+#include <linux/sched.h>
+
+#include <asm/cacheflush.h>
+#include <asm/sbi.h>
+
+/*
+ * RISC-V has no instruction cache shootdown, so every hart that may run
+ * stale code has to execute its own fence.i. Harts in mm_cpumask, which
+ * include every hart running the mm right now, get one through the SBI.
+ * All other harts are only marked in icache_stale_mask and flush in
+ * switch_to() before they next run a task of the mm, which keeps one busy
+ * process from disturbing every hart in the system.
+ *
+ * With local set, only the calling hart needs coherent instructions right
+ * away (a JIT that only runs its own code on this thread); other harts
+ * flush when a task of the mm is next scheduled onto them.
+ */
+void flush_icache_mm(struct mm_struct *mm, bool local)
+{
+	unsigned int cpu, i;
+	cpumask_t others, *mask;
+
+	preempt_disable();
+
+	/* Every hart except this one must flush before running mm again */
+	mask = &mm->context.icache_stale_mask;
+	cpumask_setall(mask);
+	cpu = smp_processor_id();
+	cpumask_clear_cpu(cpu, mask);
+	local_flush_icache_all();
+
+	cpumask_andnot(&others, mm_cpumask(mm), cpumask_of(cpu));
+	if (cpumask_empty(&others) || (local && mm == current->active_mm)) {
+		/*
+		 * Without an SBI call there is no ordering between the code
+		 * writes and a later flush_icache_deferred() on another hart;
+		 * this pairs with the barrier there.
+		 */
+		smp_mb();
+	} else {
+		/* Hart ids equal cpu ids, so the cpumask is the SBI hart mask */
+		sbi_remote_fence_i((unsigned long)cpumask_bits(&others));
+		/* Those harts are coherent now, spare them a second fence.i */
+		for_each_cpu(i, &others)
+			cpumask_clear_cpu(i, mask);
+	}
+
+	preempt_enable();
+}
@@ -0,0 +1,133 @@
+#include <linux/init.h>
+#include <linux/mm.h>
+#include <linux/percpu.h>
+#include <linux/bitops.h>
+#include <linux/spinlock.h>
+
+#include <asm/mmu_context.h>
+#include <asm/tlbflush.h>
+#include <asm/csr.h>
+
+/*
+ * ASIDs are handed out per hart, as on MIPS: each hart counts through its
+ * own ASID space, and the bits above the ASID form a generation number.
+ * An mm whose ASID on this hart is from an older generation gets a new one
+ * when it next runs here, and only starting a new generation flushes the
+ * TLB. Nothing is freed when an mm goes away; its ASID is simply not handed
+ * out again before the next rollover.
+ *
+ * A value of 0 means the mm has no ASID on that hart. Allocated values
+ * never are 0, since the first one handed out is 1.
+ *
+ * mm_cpumask holds the harts that may hold usable translations for an mm:
+ * the ones running it, and with ASIDs those that ran it and still have a
+ * valid ASID for it. The batched unmap code in mm/rmap.c flushes exactly
+ * those harts. A hart's bit goes once its ASID does, since nothing can
+ * match translations under a retired ASID before the rollover flush.
+ * asid_lock makes that check atomic with the hart switching to the mm.
+ */
+unsigned long asid_bits;
+static unsigned long asid_mask;
+static DEFINE_PER_CPU(unsigned long, asid_cache);
+static DEFINE_PER_CPU(raw_spinlock_t, asid_lock) =
+	__RAW_SPIN_LOCK_UNLOCKED(asid_lock);
+/* The mm whose page tables are in sptbr, under asid_lock */
+static DEFINE_PER_CPU(struct mm_struct *, asid_active_mm);
+
+static inline bool asid_valid(unsigned long asid, unsigned int cpu)
+{
+	return asid && !((asid ^ per_cpu(asid_cache, cpu)) & ~asid_mask);
+}
+
+static unsigned long new_context(struct mm_struct *mm, unsigned int cpu)
+{
+	unsigned long asid = per_cpu(asid_cache, cpu) + 1;
+
+	if (!(asid & asid_mask)) {
+		/* Out of ASIDs: start a new generation with a clean TLB */
+		local_flush_tlb_all();
+		if (!asid)
+			asid = asid_mask + 1;
+	}
+
+	per_cpu(asid_cache, cpu) = asid;
+	mm->context.asid[cpu] = asid;
+	return asid;
+}
+
+/* Point sptbr at next and move this hart over in mm_cpumask */
+void switch_mm_context(struct mm_struct *prev, struct mm_struct *next,
+	unsigned int cpu)
+{
+	unsigned long pfn = virt_to_pfn(next->pgd);
+	unsigned long asid;
+
+	if (!asid_bits) {
+		/* The switch flushes the TLB, so only prev's runners keep it */
+		cpumask_clear_cpu(cpu, mm_cpumask(prev));
+		cpumask_set_cpu(cpu, mm_cpumask(next));
+		csr_write(sptbr, pfn);
+		local_flush_tlb_all();
+		return;
+	}
+
+	raw_spin_lock(&per_cpu(asid_lock, cpu));
+
+	asid = next->context.asid[cpu];
+	if (!asid_valid(asid, cpu))
+		asid = new_context(next, cpu);
+	cpumask_set_cpu(cpu, mm_cpumask(next));
+	per_cpu(asid_active_mm, cpu) = next;
+
+	/* prev keeps this hart only while its ASID here survives */
+	if (!asid_valid(prev->context.asid[cpu], cpu))
+		cpumask_clear_cpu(cpu, mm_cpumask(prev));
+
+	csr_write(sptbr, pfn | ((asid & asid_mask) << SPTBR_ASID_SHIFT));
+
+	raw_spin_unlock(&per_cpu(asid_lock, cpu));
+}
+
+/*
+ * With ASIDs, a hart that is not running mm may still hold translations
+ * for it under its old ASID, which a single-page fence there would miss.
+ * Take those ASIDs away instead, along with the harts' mm_cpumask bits;
+ * they get fresh ones when they next run mm. Harts running mm keep their
+ * ASID and stay in mm_cpumask, so the caller's shootdown fences them.
+ */
+void drop_mmu_context(struct mm_struct *mm)
+{
+	raw_spinlock_t *lock;
+	unsigned long flags;
+	unsigned int i;
+
+	if (!asid_bits)
+		return;
+
+	for_each_cpu(i, mm_cpumask(mm)) {
+		lock = &per_cpu(asid_lock, i);
+		raw_spin_lock_irqsave(lock, flags);
+		if (per_cpu(asid_active_mm, i) != mm) {
+			mm->context.asid[i] = 0;
+			cpumask_clear_cpu(i, mm_cpumask(mm));
+		}
+		raw_spin_unlock_irqrestore(lock, flags);
+	}
+}
+
+void __init asid_init(void)
+{
+	unsigned long old = csr_read(sptbr);
+
+	/* The ASID field is WARL: only the implemented bits read back set */
+	csr_write(sptbr, old | SPTBR_ASID);
+	asid_bits = hweight_long(csr_read(sptbr) & SPTBR_ASID);
+	csr_write(sptbr, old);
+
+	if (asid_bits) {
+		asid_mask = (1UL << asid_bits) - 1;
+		pr_info("ASID: %lu bits\n", asid_bits);
+	} else {
+		pr_info("ASID: not supported, flushing TLB on context switch\n");
+	}
+}
@@ -6,6 +6,7 @@
 #include <linux/swap.h>
 
 #include <asm/tlbflush.h>
+#include <asm/mmu_context.h>
 #include <asm/sections.h>
 #include <asm/pgtable.h>
 #include <asm/io.h>
@@ -53,6 +54,7 @@ void __init paging_init(void)
 {
 	init_mm.pgd = (pgd_t *)pfn_to_virt(csr_read(sptbr));
 
+	asid_init();
 	setup_zero_page();
 	local_flush_tlb_all();
 	zone_sizes_init();
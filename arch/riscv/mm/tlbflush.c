@@ -0,0 +1,117 @@
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/debugfs.h>
+
+#include <asm/tlbflush.h>
+#include <asm/mmu_context.h>
+#include <asm/sbi.h>
+
+/*
+ * Ranges of up to this many pages are flushed one sfence.vm at a time;
+ * anything larger flushes the whole TLB, which is cheaper than a long run
+ * of single-page fences and the TLB misses they would avoid anyway.
+ * Tunable through debugfs, riscv/tlb_single_page_flush_ceiling.
+ */
+static u32 tlb_single_page_flush_ceiling = 33;
+
+static inline bool tlb_flush_is_full(unsigned long start, unsigned long end)
+{
+	return end == TLB_FLUSH_ALL ||
+	       (end - start) >> PAGE_SHIFT > tlb_single_page_flush_ceiling;
+}
+
+static void local_flush_tlb_range(unsigned long start, unsigned long end)
+{
+	unsigned long addr;
+
+	if (tlb_flush_is_full(start, end)) {
+		local_flush_tlb_all();
+		return;
+	}
+
+	for (addr = start & PAGE_MASK; addr < end; addr += PAGE_SIZE)
+		local_flush_tlb_page(addr);
+}
+
+#ifdef CONFIG_SMP
+/*
+ * Flush [start, end) on every hart in cpumask except this one. mm is not
+ * used; the batched unmap code in mm/rmap.c passes NULL.
+ */
+void flush_tlb_others(const struct cpumask *cpumask, struct mm_struct *mm,
+	unsigned long start, unsigned long end)
+{
+	struct cpumask others;
+	unsigned int cpu;
+
+	cpu = get_cpu();
+	cpumask_andnot(&others, cpumask, cpumask_of(cpu));
+	put_cpu();
+
+	if (cpumask_empty(&others))
+		return;
+
+	/* Hart ids equal cpu ids, so the cpumask is the SBI hart mask */
+	if (tlb_flush_is_full(start, end))
+		sbi_remote_sfence_vm((unsigned long)cpumask_bits(&others), 0);
+	else
+		sbi_remote_sfence_vm_range((unsigned long)cpumask_bits(&others),
+					   0, start & PAGE_MASK,
+					   PAGE_ALIGN(end) - (start & PAGE_MASK));
+}
+#endif /* CONFIG_SMP */
+
+/*
+ * mm_cpumask holds the harts that may have usable translations for the mm
+ * (see mm/context.c). Of those, the harts running the mm are fenced;
+ * drop_mmu_context() first retires the mm's ASID on the others and takes
+ * them out of the mask, since a page fence there would miss their ASID.
+ * An mm private to this hart never leaves it.
+ */
+static void flush_tlb_mm_range(struct mm_struct *mm, unsigned long start,
+	unsigned long end)
+{
+	preempt_disable();
+
+	drop_mmu_context(mm);
+	flush_tlb_others(mm_cpumask(mm), mm, start, end);
+	if (mm == current->active_mm)
+		local_flush_tlb_range(start, end);
+
+	preempt_enable();
+}
+
+void flush_tlb_mm(struct mm_struct *mm)
+{
+	flush_tlb_mm_range(mm, 0, TLB_FLUSH_ALL);
+}
+
+void flush_tlb_page(struct vm_area_struct *vma, unsigned long addr)
+{
+	flush_tlb_mm_range(vma->vm_mm, addr, addr + PAGE_SIZE);
+}
+
+void flush_tlb_range(struct vm_area_struct *vma, unsigned long start,
+	unsigned long end)
+{
+	flush_tlb_mm_range(vma->vm_mm, start, end);
+}
+
+/* PAGE_KERNEL mappings are global, so a page fence drops them in any ASID */
+void flush_tlb_kernel_range(unsigned long start, unsigned long end)
+{
+	preempt_disable();
+	flush_tlb_others(cpu_online_mask, NULL, start, end);
+	local_flush_tlb_range(start, end);
+	preempt_enable();
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int __init tlbflush_debugfs_init(void)
+{
+	debugfs_create_u32("tlb_single_page_flush_ceiling", S_IRUGO | S_IWUSR,
+			   arch_debugfs_dir, &tlb_single_page_flush_ceiling);
+	return 0;
+}
+late_initcall(tlbflush_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */